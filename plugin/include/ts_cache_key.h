@@ -0,0 +1,113 @@
+/** @file
+ * Compiled cache key templates.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <swoc/TextView.h>
+#include <swoc/MemArena.h>
+#include <swoc/MemSpan.h>
+#include <swoc/BufferWriter.h>
+#include <swoc/Errata.h>
+
+#include "ts_util.h"
+
+namespace ts
+{
+/** A cache key template.
+ *
+ * The template is compiled once, at configuration load, in to a sequence of extractor operations.
+ * Evaluating the template for a transaction is then a single pass over those operations with no
+ * parsing of the format.
+ *
+ * Template syntax is literal text with extractors in braces. Literal braces are written doubled,
+ * "{{" and "}}". Supported extractors
+ *
+ * - @c scheme - URL scheme.
+ * - @c host - Host of the request, from the URL or the @c Host field.
+ * - @c port - Port of the request.
+ * - @c method - Request method.
+ * - @c path - URL path, without the leading slash.
+ * - @c query - URL query string. Options, separated by ':',
+ *   - @c sorted - sort the parameters by name.
+ *   - @c allow=a,b - only keep the named parameters.
+ *   - @c deny=a,b - drop the named parameters.
+ * - @c hdr:Name - Value of the request field @a Name.
+ *
+ * For example "{host}/{path}?{query:sorted:allow=a,b}{hdr:X-Variant}".
+ */
+class CacheKeyTemplate
+{
+  using self_type = CacheKeyTemplate; ///< Self reference type.
+public:
+  CacheKeyTemplate()                  = default;
+  CacheKeyTemplate(self_type &&that)  = default;
+  self_type &operator=(self_type &&that) = default;
+
+  /** Compile a template.
+   *
+   * @param fmt Template text.
+   * @return The compiled template, or errors if @a fmt is not valid.
+   */
+  static swoc::Rv<self_type> compile(swoc::TextView fmt);
+
+  /** Evaluate the template.
+   *
+   * @param w Output buffer.
+   * @param txn Transaction.
+   * @return @a w
+   */
+  swoc::BufferWriter &write(swoc::BufferWriter &w, HttpTxn &txn) const;
+
+  /** Evaluate the template and set the result as the cache key for @a txn.
+   *
+   * @param txn Transaction.
+   * @return Result of setting the key.
+   *
+   * The key is built in a stack buffer, falling back to a scratch arena only for unusually long keys.
+   */
+  Status assign(HttpTxn &txn) const;
+
+  /// @return @c true if there are no operations in the template.
+  bool
+  empty() const
+  {
+    return _ops.empty();
+  }
+
+protected:
+  /// Operation type.
+  enum class OpType : uint8_t { LITERAL, SCHEME, HOST, PORT, METHOD, PATH, QUERY, FIELD };
+
+  /// A single extractor.
+  struct Op {
+    OpType _type = OpType::LITERAL;
+    swoc::TextView _text;                ///< Literal text or field name.
+    bool _sorted_p = false;               ///< Sort query parameters.
+    bool _filter_p = false;               ///< @a _names is set as an allow or deny list.
+    bool _deny_p   = false;               ///< @a _names is a deny list, not an allow list.
+    swoc::MemSpan<swoc::TextView> _names; ///< Query parameter names to allow or deny.
+  };
+
+  /// Upper bound on the number of query parameters sorted in place on the stack.
+  static constexpr size_t MAX_SORTED_PARAMS = 64;
+
+  swoc::MemArena _arena{512}; ///< Storage for localized strings.
+  std::vector<Op> _ops;       ///< Compiled operations.
+
+  /// Copy @a text in to the arena.
+  swoc::TextView localize(swoc::TextView const &text);
+
+  /// Parse the extractor @a spec in to an operation.
+  swoc::Errata parse_extractor(swoc::TextView spec);
+
+  /// Write the query string @a query to @a w as specified by @a op.
+  static void write_query(swoc::BufferWriter &w, Op const &op, swoc::TextView query);
+};
+
+} // namespace ts
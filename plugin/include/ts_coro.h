@@ -0,0 +1,267 @@
+/** @file
+ * Coroutine adapters for TS continuations.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * This requires C++20 - build with @c SWOC_TS_API_CXX20 enabled. Otherwise this header is empty.
+ */
+
+#pragma once
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#define TS_UTIL_HAS_COROUTINES 1
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+
+#include "ts_util.h"
+
+namespace ts
+{
+/** Per thread pool of coroutine frames.
+ *
+ * Frames are pooled in size classes, so a coroutine that is started repeatedly on a thread does
+ * not normally allocate. Frames larger than the largest class use the global allocator.
+ */
+class CoroFramePool
+{
+public:
+  static constexpr size_t CLASS_SIZE = 64; ///< Size class granularity.
+  static constexpr size_t N_CLASSES  = 16; ///< Number of size classes.
+  static constexpr size_t MAX_POOLED = 64; ///< Maximum frames pooled per class per thread.
+
+  /// @return Memory for a frame of @a n bytes.
+  static void *alloc(size_t n);
+
+  /// Release the frame @a ptr of @a n bytes.
+  static void free(void *ptr, size_t n);
+};
+
+/** A coroutine run for its effects.
+ *
+ * The coroutine starts immediately and its frame is destroyed when it finishes. There is no
+ * result and it can not be awaited - a coroutine that needs to pass back a value should use a
+ * @c Promise.
+ *
+ * @code
+ *   ts::CoTask fetch(ts::HttpTxn txn) {
+ *     auto data = co_await ts::PerformAsTaskFuture([] { return load(); });
+ *     // ... back on the original thread.
+ *     TSHttpTxnReenable(txn, TS_EVENT_HTTP_CONTINUE);
+ *   }
+ * @endcode
+ */
+struct CoTask {
+  struct promise_type {
+    CoTask
+    get_return_object() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never
+    initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never
+    final_suspend() noexcept
+    {
+      return {};
+    }
+
+    void
+    return_void() noexcept
+    {
+    }
+
+    void
+    unhandled_exception() noexcept
+    {
+      std::terminate(); // Nothing can catch it on a TS thread.
+    }
+
+    static void *
+    operator new(size_t n)
+    {
+      return CoroFramePool::alloc(n);
+    }
+
+    static void
+    operator delete(void *ptr, size_t n)
+    {
+      CoroFramePool::free(ptr, n);
+    }
+  };
+};
+
+/** Resume on a thread pool.
+ *
+ * @code
+ *   co_await ts::ResumeOn{TS_THREAD_POOL_TASK};
+ * @endcode
+ */
+struct ResumeOn {
+  TSThreadPool _pool = TS_THREAD_POOL_TASK; ///< Pool for resuming.
+
+  bool
+  await_ready() const noexcept
+  {
+    return false;
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> h) const
+  {
+    PerformAsTaskAfter([h]() { h.resume(); }, std::chrono::milliseconds{0}, _pool);
+  }
+
+  void
+  await_resume() const noexcept
+  {
+  }
+};
+
+/** Resume after a delay.
+ *
+ * @code
+ *   co_await ts::Sleep{std::chrono::milliseconds{250}};
+ * @endcode
+ */
+struct Sleep {
+  std::chrono::milliseconds _delay;         ///< Delay before resuming.
+  TSThreadPool _pool = TS_THREAD_POOL_TASK; ///< Pool for resuming.
+
+  bool
+  await_ready() const noexcept
+  {
+    return _delay.count() <= 0;
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> h) const
+  {
+    PerformAsTaskAfter([h]() { h.resume(); }, _delay, _pool);
+  }
+
+  void
+  await_resume() const noexcept
+  {
+  }
+};
+
+/** Wait for a transaction hook.
+ *
+ * The coroutine is resumed on the transaction thread when the hook is invoked. The coroutine must
+ * then reenable the transaction.
+ *
+ * If the result is @c TS_EVENT_HTTP_TXN_CLOSE the coroutine must not reenable the transaction, the
+ * close hook is reenabled when the coroutine next suspends or finishes, and the transaction must
+ * not be used after that. This is the result if the transaction closes before the hook is invoked,
+ * such as when it is aborted or the hook has already passed, and also if the awaited hook is
+ * @c TS_HTTP_TXN_CLOSE_HOOK.
+ *
+ * @note If the coroutine is in a hook, that hook must be reenabled before awaiting a later hook,
+ * otherwise the transaction never reaches the later hook and deadlocks.
+ *
+ * @code
+ *   if (co_await ts::WaitForHook{txn, TS_HTTP_READ_RESPONSE_HDR_HOOK} == TS_EVENT_HTTP_TXN_CLOSE) {
+ *     co_return;
+ *   }
+ *   // ... inspect the response.
+ *   TSHttpTxnReenable(txn, TS_EVENT_HTTP_CONTINUE);
+ * @endcode
+ */
+class WaitForHook
+{
+public:
+  /** Construct.
+   *
+   * @param txn Transaction.
+   * @param hook Hook to wait for.
+   */
+  WaitForHook(TSHttpTxn txn, TSHttpHookID hook) : _txn(txn), _hook(hook) {}
+
+  bool
+  await_ready() const noexcept
+  {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> h);
+
+  /// @return The hook event, or @c TS_EVENT_HTTP_TXN_CLOSE if the transaction closed first.
+  TSEvent
+  await_resume() const noexcept
+  {
+    return _event;
+  }
+
+protected:
+  TSHttpTxn _txn;                  ///< Transaction.
+  TSHttpHookID _hook;              ///< Hook.
+  TSEvent _event = TS_EVENT_NONE;  ///< Event from the hook.
+  std::coroutine_handle<> _handle; ///< Coroutine to resume.
+
+  /** Hook handler.
+   *
+   * The continuation is also on the transaction close hook, because there is no way to tell if the
+   * awaited hook will be invoked. It is destroyed on close, and its data is cleared once the
+   * coroutine is resumed.
+   */
+  static int on_hook(TSCont contp, TSEvent event, void *);
+};
+
+/** Await a @c Future.
+ *
+ * @tparam R Result type.
+ *
+ * The coroutine is resumed on the thread that created the promise, with the result. The result is
+ * empty if the promise was broken.
+ */
+template <typename R> class FutureAwaiter
+{
+public:
+  explicit FutureAwaiter(Future<R> &&future) : _future(std::move(future)) {}
+
+  bool
+  await_ready() const noexcept
+  {
+    return false;
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> h)
+  {
+    _future.then([this, h](std::optional<R> &value) {
+      _value = std::move(value);
+      h.resume();
+    });
+  }
+
+  std::optional<R>
+  await_resume()
+  {
+    return std::move(_value);
+  }
+
+protected:
+  Future<R> _future;       ///< Future to await.
+  std::optional<R> _value; ///< Result.
+};
+
+/// Make @c Future awaitable.
+template <typename R>
+FutureAwaiter<R>
+operator co_await(Future<R> &&future)
+{
+  return FutureAwaiter<R>{std::move(future)};
+}
+
+} // namespace ts
+
+#endif
@@ -0,0 +1,119 @@
+/** @file
+ * Domain matching for host and SNI allow lists.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <swoc/TextView.h>
+#include <swoc/MemArena.h>
+#include <swoc/Errata.h>
+
+#include "ts_util.h"
+
+namespace ts
+{
+/** Match names against a set of domains.
+ *
+ * Domains are added with @c add and then the matcher is compiled with @c compile, both done at
+ * configuration load. A domain can be
+ *
+ * - exact, "www.example.com", which matches only that name.
+ * - wildcard, "*.example.com", which matches any name that ends with ".example.com".
+ *
+ * Matching is case insensitive and a trailing '.' on a name is ignored.
+ *
+ * Domains are stored as a trie of labels, from the top level domain down. Nodes are kept in a
+ * single array, with children contiguous and sorted, and label text is packed in to a single
+ * string. This keeps large lists (hundreds of thousands of domains) compact and a lookup is a
+ * binary search per label of the name.
+ */
+class DomainMatcher
+{
+  using self_type = DomainMatcher; ///< Self reference type.
+public:
+  DomainMatcher() = default;
+
+  /** Add a domain.
+   *
+   * @param domain Domain, exact or wildcard.
+   * @return Errors, if any.
+   */
+  swoc::Errata add(swoc::TextView domain);
+
+  /// Compile the domains. This must be called after the domains are added and before lookup.
+  self_type &compile();
+
+  /** Check for a match.
+   *
+   * @param name Name to check.
+   * @return @c true if @a name is matched by a domain, @c false if not.
+   */
+  bool contains(swoc::TextView name) const;
+
+  /// Check the host of @a req.
+  bool
+  contains(HttpRequest const &req) const
+  {
+    return this->contains(req.host());
+  }
+
+  /// Check the SNI name of @a ssl.
+  bool
+  contains(SSLContext const &ssl) const
+  {
+    return this->contains(ssl.sni());
+  }
+
+  /// @return The number of domains.
+  size_t
+  count() const
+  {
+    return _count;
+  }
+
+protected:
+  static constexpr uint32_t NONE    = ~uint32_t(0); ///< Invalid index.
+  static constexpr uint8_t EXACT    = 1;            ///< Node is the end of an exact domain.
+  static constexpr uint8_t WILDCARD = 2;            ///< Node is the end of a wildcard domain.
+  static constexpr size_t MAX_LABEL = 63;           ///< Longest valid label.
+
+  /// Trie node.
+  struct Node {
+    uint32_t _text    = 0;    ///< Offset of label text in @a _labels.
+    uint8_t _len      = 0;    ///< Length of label.
+    uint8_t _flags    = 0;    ///< Match flags.
+    uint32_t _child   = NONE; ///< Index of first child.
+    uint32_t _n_child = 0;    ///< Number of children.
+  };
+
+  /// A domain being compiled.
+  struct Entry {
+    std::vector<swoc::TextView> _labels; ///< Labels, reversed.
+    uint8_t _flags = 0;                  ///< Match type.
+  };
+
+  std::string _labels;      ///< Packed label text.
+  std::vector<Node> _nodes; ///< Trie nodes, the root is the first.
+  size_t _count = 0;        ///< Number of domains.
+
+  swoc::MemArena _arena;       ///< Label storage during loading.
+  std::vector<Entry> _pending; ///< Domains during loading.
+
+  /// @return The label text for @a node.
+  swoc::TextView
+  label(Node const &node) const
+  {
+    return {_labels.data() + node._text, node._len};
+  }
+
+  /// Fill in node @a idx from the sorted entries in [ @a begin, @a end ) which share @a depth labels.
+  void build(uint32_t idx, Entry *begin, Entry *end, size_t depth);
+};
+
+} // namespace ts
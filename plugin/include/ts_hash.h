@@ -0,0 +1,218 @@
+/** @file
+ * Streaming hashes for URLs and request targets.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <iterator>
+#include <limits>
+
+#include <swoc/TextView.h>
+
+#include "ts_util.h"
+
+namespace ts
+{
+/** Streaming 64 bit hash.
+ *
+ * This is XXH64 - data can be fed incrementally, in any size pieces, and the result is the same
+ * as hashing the concatenation of those pieces.
+ */
+class Hash64
+{
+  using self_type = Hash64; ///< Self reference type.
+public:
+  using value_type = uint64_t;
+
+  /// Construct with an optional @a seed.
+  explicit Hash64(uint64_t seed = 0);
+
+  /// Add @a data to the hash.
+  self_type &update(void const *data, size_t n);
+
+  /// Add @a text to the hash.
+  self_type &
+  update(swoc::TextView const &text)
+  {
+    return this->update(text.data(), text.size());
+  }
+
+  /// Add a single character.
+  self_type &
+  update(char c)
+  {
+    return this->update(&c, 1);
+  }
+
+  /// Add @a text to the hash, converted to lower case.
+  self_type &update_nocase(swoc::TextView text);
+
+  /// @return The hash of the data so far. This does not modify the state, more data can be added.
+  value_type final() const;
+
+protected:
+  static constexpr size_t STRIPE = 32; ///< Bytes consumed per round.
+
+  std::array<uint64_t, 4> _v;         ///< Accumulators.
+  uint64_t _seed;                     ///< Initial seed.
+  uint64_t _total = 0;                ///< Total bytes hashed.
+  std::array<uint8_t, STRIPE> _buff;  ///< Partial stripe.
+  size_t _buff_n = 0;                 ///< Bytes in @a _buff.
+};
+
+/** Streaming 128 bit hash.
+ *
+ * This is two independently seeded @c Hash64 lanes run over the same data.
+ */
+class Hash128
+{
+  using self_type = Hash128; ///< Self reference type.
+public:
+  /// Hash value - low order 64 bits first.
+  using value_type = std::array<uint64_t, 2>;
+
+  explicit Hash128(uint64_t seed = 0);
+
+  self_type &update(void const *data, size_t n);
+
+  self_type &
+  update(swoc::TextView const &text)
+  {
+    return this->update(text.data(), text.size());
+  }
+
+  self_type &
+  update(char c)
+  {
+    return this->update(&c, 1);
+  }
+
+  self_type &update_nocase(swoc::TextView text);
+
+  value_type final() const;
+
+protected:
+  Hash64 _lo; ///< Low order lane.
+  Hash64 _hi; ///< High order lane.
+};
+
+/// Feed @a port as ":" followed by decimal text.
+template <typename H>
+H &
+hash_port(H &h, in_port_t port)
+{
+  char buff[1 + std::numeric_limits<in_port_t>::digits10 + 1];
+  char *spot = std::end(buff);
+  do {
+    *--spot = '0' + port % 10;
+    port /= 10;
+  } while (port);
+  *--spot = ':';
+  return h.update(spot, std::end(buff) - spot);
+}
+
+/** Feed a URL to a hash.
+ *
+ * @param h Hash.
+ * @param url URL.
+ * @return @a h
+ *
+ * The URL is fed as its components, without building the URL string. The result is the same as
+ * hashing the text "scheme://host:port/path?query", with empty elements and a canonical port
+ * omitted.
+ */
+template <typename H>
+H &
+hash_url(H &h, URL const &url)
+{
+  if (auto scheme = url.scheme(); !scheme.empty()) {
+    h.update(scheme).update(':');
+  }
+  if (auto host = url.host(); !host.empty()) {
+    h.update("//").update(host);
+    if (auto port = url.port(); port != 0 && !url.is_port_canonical()) {
+      hash_port(h, port);
+    }
+  }
+  if (auto path = url.path(); !path.empty()) {
+    h.update('/').update(path);
+  }
+  if (auto query = url.query(); !query.empty()) {
+    h.update('?').update(query);
+  }
+  return h;
+}
+
+/** Feed the normalized target of a request to a hash.
+ *
+ * @param h Hash.
+ * @param req Request.
+ * @return @a h
+ *
+ * The target is normalized by using the host from the URL or @c Host field, folding the scheme and
+ * host to lower case, and dropping the port if it is canonical for the scheme. Requests that differ
+ * only in those ways hash identically.
+ */
+template <typename H>
+H &
+hash_request_target(H &h, HttpRequest const &req)
+{
+  auto url{req.url()};
+  auto scheme{url.scheme()};
+  if (!scheme.empty()) {
+    h.update_nocase(scheme).update(':');
+  }
+  if (auto host = req.host(); !host.empty()) {
+    h.update("//").update_nocase(host);
+    if (auto port = req.port(); port != 0 && !URL::is_port_canonical(scheme, port)) {
+      hash_port(h, port);
+    }
+  }
+  if (auto path = url.path(); !path.empty()) {
+    h.update('/').update(path);
+  }
+  if (auto query = url.query(); !query.empty()) {
+    h.update('?').update(query);
+  }
+  return h;
+}
+
+/// @return 64 bit hash of @a url.
+inline uint64_t
+url_hash64(URL const &url, uint64_t seed = 0)
+{
+  Hash64 h{seed};
+  return hash_url(h, url).final();
+}
+
+/// @return 128 bit hash of @a url.
+inline Hash128::value_type
+url_hash128(URL const &url, uint64_t seed = 0)
+{
+  Hash128 h{seed};
+  return hash_url(h, url).final();
+}
+
+/// @return 64 bit hash of the normalized target of @a req.
+inline uint64_t
+request_target_hash64(HttpRequest const &req, uint64_t seed = 0)
+{
+  Hash64 h{seed};
+  return hash_request_target(h, req).final();
+}
+
+/// @return 128 bit hash of the normalized target of @a req.
+inline Hash128::value_type
+request_target_hash128(HttpRequest const &req, uint64_t seed = 0)
+{
+  Hash128 h{seed};
+  return hash_request_target(h, req).final();
+}
+
+} // namespace ts
@@ -0,0 +1,67 @@
+/** @file
+ * Percent encoding and decoding.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <swoc/TextView.h>
+#include <swoc/BufferWriter.h>
+
+namespace ts
+{
+/** Characters which are left unencoded.
+ *
+ * In all cases, characters outside the set are percent encoded.
+ */
+enum class PctSet {
+  UNRESERVED, ///< RFC 3986 unreserved - alphanumerics and "-._~".
+  PATH,       ///< Path segments - unreserved, sub-delimiters, ":@/".
+  QUERY,      ///< Query parameter names and values - as @c PATH plus "?", without "&+;=".
+};
+
+/** Check if @a text needs percent encoding.
+ *
+ * @param text Text to check.
+ * @param set Characters which do not need encoding.
+ * @return @c true if @a text contains any characters outside @a set.
+ *
+ * Where supported by the CPU this checks 16 characters at a time, so it is very cheap for text
+ * which is already clean.
+ */
+bool pct_needs_encoding(swoc::TextView text, PctSet set = PctSet::UNRESERVED);
+
+/** Percent encode @a text.
+ *
+ * @param w Output.
+ * @param text Text to encode.
+ * @param set Characters to leave unencoded.
+ * @return @a w
+ *
+ * Runs of characters that do not need encoding are copied in bulk.
+ */
+swoc::BufferWriter &pct_encode(swoc::BufferWriter &w, swoc::TextView text, PctSet set = PctSet::UNRESERVED);
+
+/** Check if @a text needs percent decoding.
+ *
+ * @param text Text to check.
+ * @param plus_p Treat '+' as an encoded space.
+ * @return @c true if @a text contains '%', or '+' if @a plus_p.
+ */
+bool pct_needs_decoding(swoc::TextView text, bool plus_p = false);
+
+/** Percent decode @a text.
+ *
+ * @param w Output.
+ * @param text Text to decode.
+ * @param plus_p Decode '+' as a space, as in form encoded query strings.
+ * @return @a w
+ *
+ * Invalid escapes are copied unchanged. The output is never longer than @a text, so decoding in to
+ * a buffer the size of @a text cannot overflow.
+ */
+swoc::BufferWriter &pct_decode(swoc::BufferWriter &w, swoc::TextView text, bool plus_p = false);
+
+} // namespace ts
@@ -0,0 +1,295 @@
+/** @file
+ * Compiled host / path routing table.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+#include <vector>
+
+#include <swoc/TextView.h>
+#include <swoc/MemArena.h>
+#include <swoc/Errata.h>
+
+#include "ts_util.h"
+
+namespace ts
+{
+/** Routing table keyed by host and path prefix.
+ *
+ * @tparam T Payload type.
+ *
+ * Rules are added with @c add and then the table is compiled with @c compile, both done at
+ * configuration load. Hosts are matched case insensitively and can be
+ *
+ * - exact, "www.example.com"
+ * - wildcard suffix, "*.example.com" which matches any host that ends with ".example.com".
+ * - any, "*" or empty, which matches every host.
+ *
+ * Each host has a radix tree of path prefixes, stored as a flat array of nodes. Paths are without
+ * the leading slash, as with @c URL::path, and a leading slash in a rule is ignored.
+ *
+ * Lookup tries the exact host, then wildcard suffixes from longest to shortest, then the any host.
+ * The first of those with a matching path prefix is used, and within that the longest matching
+ * prefix is selected.
+ */
+template <typename T> class RouteTable
+{
+  using self_type = RouteTable; ///< Self reference type.
+public:
+  using value_type = T;
+
+  RouteTable() = default;
+
+  /** Add a rule.
+   *
+   * @param host Host, which may be exact, wildcard, or any.
+   * @param path Path prefix.
+   * @param payload Payload for the rule.
+   * @return Errors, if any.
+   */
+  swoc::Errata add(swoc::TextView host, swoc::TextView path, T &&payload);
+
+  /// Compile the rules. This must be called after the rules are added and before lookup.
+  self_type &compile();
+
+  /** Find the payload for @a host and @a path.
+   *
+   * @param host Host.
+   * @param path Path.
+   * @return The payload for the best matching rule, or @c nullptr if no rule matches.
+   */
+  T const *find(swoc::TextView host, swoc::TextView path) const;
+
+  /// Find the payload for the host and path of @a req.
+  T const *
+  find(HttpRequest const &req) const
+  {
+    return this->find(req.host(), req.url().path());
+  }
+
+  /// @return The number of rules.
+  size_t
+  count() const
+  {
+    return _payloads.size();
+  }
+
+protected:
+  static constexpr uint32_t NONE      = ~uint32_t(0); ///< Invalid index.
+  static constexpr size_t MAX_HOST    = 255;          ///< Longest host that can match.
+
+  /// Node in a path radix tree.
+  struct Node {
+    swoc::TextView _label;      ///< Edge label from parent.
+    uint32_t _child   = NONE;   ///< Index of first child.
+    uint32_t _n_child = 0;      ///< Number of children.
+    uint32_t _payload = NONE;   ///< Payload index, if this is the end of a rule.
+  };
+
+  /// A rule being compiled.
+  struct Rule {
+    swoc::TextView _path;
+    uint32_t _payload;
+  };
+
+  using Table = std::unordered_map<swoc::TextView, uint32_t, std::hash<std::string_view>>;
+
+  swoc::MemArena _arena;       ///< Storage for localized strings.
+  std::vector<T> _payloads;    ///< Rule payloads.
+  std::vector<Node> _nodes;    ///< Tree nodes for all hosts.
+  Table _exact;                ///< Exact host to root node.
+  Table _wild;                 ///< Wildcard suffix to root node.
+  uint32_t _any = NONE;        ///< Root node for any host.
+
+  /// Rules per host, only during loading.
+  std::unordered_map<swoc::TextView, std::vector<Rule>, std::hash<std::string_view>> _pending;
+
+  /// Copy @a text in to the arena, lower casing if @a nocase_p.
+  swoc::TextView localize(swoc::TextView const &text, bool nocase_p);
+
+  /// Build a tree from the sorted @a rules, returning the root index.
+  uint32_t build(std::vector<Rule> &rules);
+
+  /// Fill in node @a idx from the sorted rules in [ @a begin, @a end ) which share @a depth characters.
+  void build(uint32_t idx, Rule const *begin, Rule const *end, size_t depth);
+
+  /// Longest prefix match of @a path in the tree at @a root.
+  uint32_t match(uint32_t root, swoc::TextView path) const;
+};
+
+template <typename T>
+swoc::TextView
+RouteTable<T>::localize(swoc::TextView const &text, bool nocase_p)
+{
+  auto span = _arena.alloc(text.size()).template rebind<char>();
+  if (nocase_p) {
+    std::transform(text.begin(), text.end(), span.begin(), [](char c) { return char(tolower(static_cast<unsigned char>(c))); });
+  } else {
+    memcpy(span.data(), text.data(), text.size());
+  }
+  return {span.data(), span.count()};
+}
+
+template <typename T>
+swoc::Errata
+RouteTable<T>::add(swoc::TextView host, swoc::TextView path, T &&payload)
+{
+  host.trim_if(&isspace);
+  if (host.find('*', 1) != swoc::TextView::npos || (host.size() > 1 && host[0] == '*' && (host[1] != '.' || host.size() == 2))) {
+    return swoc::Errata(S_ERROR, R"(Route host "{}" is invalid - a wildcard must be "*" or a leading "*.".)", host);
+  }
+  if (host.size() > MAX_HOST) {
+    return swoc::Errata(S_ERROR, R"(Route host "{}" is longer than {} characters.)", host, MAX_HOST);
+  }
+  host.rtrim('.'); // fully qualified form, as for @c find.
+  if (host.size() == 1 && host[0] == '*') {
+    host.clear();
+  }
+  path.ltrim('/');
+
+  auto key = this->localize(host, true);
+  auto &rules{_pending[key]};
+  auto p = this->localize(path, false);
+  if (std::any_of(rules.begin(), rules.end(), [&](Rule const &r) { return r._path == p; })) {
+    return swoc::Errata(S_ERROR, R"(Duplicate route for host "{}" path "{}".)", host, path);
+  }
+  rules.push_back({p, static_cast<uint32_t>(_payloads.size())});
+  _payloads.emplace_back(std::move(payload));
+  return {};
+}
+
+template <typename T>
+auto
+RouteTable<T>::compile() -> self_type &
+{
+  for (auto &[host, rules] : _pending) {
+    auto root = this->build(rules);
+    if (host.empty()) {
+      _any = root;
+    } else if (host[0] == '*') {
+      _wild[host.substr(2)] = root;
+    } else {
+      _exact[host] = root;
+    }
+  }
+  _pending.clear();
+  _nodes.shrink_to_fit();
+  return *this;
+}
+
+template <typename T>
+uint32_t
+RouteTable<T>::build(std::vector<Rule> &rules)
+{
+  std::sort(rules.begin(), rules.end(), [](Rule const &lhs, Rule const &rhs) { return lhs._path < rhs._path; });
+  uint32_t root = _nodes.size();
+  _nodes.emplace_back();
+  this->build(root, rules.data(), rules.data() + rules.size(), 0);
+  return root;
+}
+
+template <typename T>
+void
+RouteTable<T>::build(uint32_t idx, Rule const *begin, Rule const *end, size_t depth)
+{
+  // Rules are sorted and unique, so at most the first rule ends at this node.
+  if (begin < end && begin->_path.size() == depth) {
+    _nodes[idx]._payload = begin->_payload;
+    ++begin;
+  }
+  if (begin == end) {
+    return;
+  }
+
+  // Count the groups by next character - each is a child. Children are contiguous so they are
+  // allocated before any descendants.
+  uint32_t n = 0;
+  for (auto spot = begin; spot < end; ++n) {
+    char c = spot->_path[depth];
+    spot   = std::find_if(spot, end, [=](Rule const &r) { return r._path[depth] != c; });
+  }
+  uint32_t child = _nodes.size();
+  _nodes[idx]._child   = child;
+  _nodes[idx]._n_child = n;
+  _nodes.resize(_nodes.size() + n);
+
+  for (auto spot = begin; spot < end; ++child) {
+    char c     = spot->_path[depth];
+    auto limit = std::find_if(spot, end, [=](Rule const &r) { return r._path[depth] != c; });
+    // Edge label is the common prefix of the group past @a depth. Sorted, so only the first and
+    // last need to be compared.
+    auto first = spot->_path.substr(depth);
+    auto last  = (limit - 1)->_path.substr(depth);
+    size_t lcp = std::mismatch(first.begin(), first.begin() + std::min(first.size(), last.size()), last.begin()).first - first.begin();
+    _nodes[child]._label = first.prefix(lcp);
+    this->build(child, spot, limit, depth + lcp);
+    spot = limit;
+  }
+}
+
+template <typename T>
+uint32_t
+RouteTable<T>::match(uint32_t root, swoc::TextView path) const
+{
+  uint32_t zret = _nodes[root]._payload;
+  Node const *node = &_nodes[root];
+  while (path && node->_n_child) {
+    auto first = _nodes.begin() + node->_child;
+    auto last  = first + node->_n_child;
+    // Children are in sorted order, which compares characters as unsigned.
+    auto spot = std::lower_bound(first, last, static_cast<unsigned char>(path[0]),
+                                 [](Node const &n, unsigned char c) { return static_cast<unsigned char>(n._label[0]) < c; });
+    if (spot == last || spot->_label[0] != path[0] || !path.starts_with(spot->_label)) {
+      break;
+    }
+    path.remove_prefix(spot->_label.size());
+    node = &*spot;
+    if (node->_payload != NONE) {
+      zret = node->_payload;
+    }
+  }
+  return zret;
+}
+
+template <typename T>
+T const *
+RouteTable<T>::find(swoc::TextView host, swoc::TextView path) const
+{
+  path.ltrim('/');
+  if (host.size() <= MAX_HOST) {
+    char buff[MAX_HOST];
+    std::transform(host.begin(), host.end(), buff, [](char c) { return char(tolower(static_cast<unsigned char>(c))); });
+    swoc::TextView key{buff, host.size()};
+    key.rtrim('.'); // fully qualified form matches the same rules.
+
+    if (auto spot = _exact.find(key); spot != _exact.end()) {
+      if (auto idx = this->match(spot->second, path); idx != NONE) {
+        return &_payloads[idx];
+      }
+    }
+    if (!_wild.empty()) {
+      // Drop the leading label each time, so longer suffixes are checked first.
+      while (key.take_prefix_at('.'), key) {
+        if (auto spot = _wild.find(key); spot != _wild.end()) {
+          if (auto idx = this->match(spot->second, path); idx != NONE) {
+            return &_payloads[idx];
+          }
+        }
+      }
+    }
+  }
+  if (_any != NONE) {
+    if (auto idx = this->match(_any, path); idx != NONE) {
+      return &_payloads[idx];
+    }
+  }
+  return nullptr;
+}
+
+} // namespace ts
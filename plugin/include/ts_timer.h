@@ -0,0 +1,171 @@
+/** @file
+ * Hashed hierarchical timing wheel.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <swoc/MemSpan.h>
+
+#include "ts_util.h"
+
+namespace ts
+{
+class TimerWheel;
+
+/** A timer in a @c TimerWheel.
+ *
+ * This is intrusive - it is intended to be a base class or member of the object to which the timer
+ * applies, so that a timer does not allocate. The object must not be destroyed while the timer is
+ * active or while its expiry is being handled.
+ */
+class Timer
+{
+  friend class TimerWheel;
+
+public:
+  Timer() = default;
+  Timer(Timer const &) = delete;
+  Timer &operator=(Timer const &) = delete;
+
+  /// @return @c true if the timer is scheduled.
+  bool
+  is_active() const
+  {
+    return _pprev != nullptr;
+  }
+
+protected:
+  Timer *_next     = nullptr; ///< Next timer in the slot.
+  Timer **_pprev   = nullptr; ///< Link to this timer in the slot.
+  uint64_t _expire = 0;       ///< Expiration tick.
+};
+
+/** Hashed hierarchical timing wheel.
+ *
+ * This supports very large numbers of timers, such as per client rate limits or expirations.
+ * Scheduling and canceling a timer is constant time, and timers are driven by a single periodic
+ * task regardless of how many there are. Expired timers are passed to the expiry callback in
+ * batches.
+ *
+ * The wheel has @c N_LEVELS levels of @c N_SLOTS slots. Timers due within @c N_SLOTS ticks are in
+ * the first level, later timers in higher levels. As time advances timers cascade down to lower
+ * levels. The longest delay is about 2^32 ticks, longer delays are clamped to that.
+ *
+ * @code
+ *   struct Client : ts::Timer { ... };
+ *   ts::TimerWheel wheel{std::chrono::milliseconds{10}, [](ts::TimerWheel::Batch batch) {
+ *     for (auto t : batch) {
+ *       auto client = static_cast<Client *>(t);
+ *       // ...
+ *     }
+ *   }};
+ *   wheel.start();
+ *   wheel.schedule(client, std::chrono::seconds{30});
+ * @endcode
+ */
+class TimerWheel
+{
+  using self_type = TimerWheel; ///< Self reference type.
+public:
+  static constexpr unsigned SLOT_BITS = 8;                        ///< Bits of tick per level.
+  static constexpr size_t N_SLOTS     = size_t(1) << SLOT_BITS; ///< Slots per level.
+  static constexpr unsigned N_LEVELS  = 4;                        ///< Number of levels.
+  static constexpr size_t MAX_BATCH   = 1024;                     ///< Maximum timers per expiry callback.
+
+  using Batch    = swoc::MemSpan<Timer *>;     ///< Expired timers.
+  using ExpireFn = std::function<void(Batch)>; ///< Expiry callback.
+
+  /** Construct.
+   *
+   * @param resolution Time per tick.
+   * @param f Expiry callback.
+   *
+   * Expired timers are inactive when passed to @a f, which can schedule them again.
+   */
+  TimerWheel(std::chrono::milliseconds resolution, ExpireFn &&f);
+
+  /// Destructor - this stops the periodic task.
+  ~TimerWheel();
+
+  /// Start the periodic task which drives the wheel.
+  void start();
+
+  /** Stop the periodic task. Active timers are not changed.
+   *
+   * If a tick is in progress on another thread, this waits for it to finish, so the wheel can be
+   * destroyed once this returns. Therefore this must not be called from the expiry callback.
+   */
+  void stop();
+
+  /** Schedule @a timer.
+   *
+   * @param timer Timer.
+   * @param delay Time until @a timer expires.
+   *
+   * If @a timer is already active it is rescheduled.
+   */
+  void schedule(Timer &timer, std::chrono::milliseconds delay);
+
+  /** Cancel @a timer.
+   *
+   * @param timer Timer.
+   * @return @c true if @a timer was active.
+   */
+  bool cancel(Timer &timer);
+
+  /// @return The number of active timers.
+  size_t count() const;
+
+  /** Advance the wheel by @a n ticks.
+   *
+   * @param n Number of ticks.
+   *
+   * This is done by the periodic task. It is available to drive the wheel directly, such as from
+   * an existing periodic task, in which case @c start should not be called. Calls must be
+   * serialized, as the expired timers are collected in a member which is used without the lock.
+   */
+  void advance(uint64_t n);
+
+protected:
+  mutable std::mutex _lock;                                    ///< Serialize access to the slots.
+  std::array<std::array<Timer *, N_SLOTS>, N_LEVELS> _slots{}; ///< Timer lists.
+  uint64_t _now = 0;                                           ///< Current tick.
+  size_t _count = 0;                                           ///< Number of active timers.
+
+  std::chrono::milliseconds _resolution;        ///< Time per tick.
+  std::chrono::steady_clock::time_point _epoch; ///< Time of tick 0.
+  ExpireFn _expire_fn;                          ///< Expiry callback.
+  std::vector<Timer *> _expired;                ///< Expired timers, reused for each tick.
+  TaskHandle _task;                             ///< Periodic task.
+
+  /// Shared with the periodic task, so that a tick in progress can be waited for.
+  struct Gate {
+    std::mutex _lock;            ///< Held while ticking.
+    self_type *_wheel = nullptr; ///< Wheel to tick, cleared when stopped.
+  };
+  std::shared_ptr<Gate> _gate; ///< Gate for the current periodic task.
+
+  /// Put @a timer in the slot for its expiration.
+  void link(Timer *timer);
+
+  /// Remove @a timer from its slot.
+  static void unlink(Timer *timer);
+
+  /// Move the timers in the current slot of @a level to lower levels.
+  void cascade(unsigned level);
+
+  /// Advance to the tick for the current time.
+  void tick();
+};
+
+} // namespace ts
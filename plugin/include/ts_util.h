@@ -8,8 +8,19 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include <swoc/swoc_file.h>
 #include <swoc/MemArena.h>
@@ -31,6 +42,53 @@ constexpr swoc::Errata::Severity S_WARNING{4};
 constexpr swoc::Errata::Severity S_ERROR{5};
 
 class SSLContext;
+class LocalStorage;
+
+/** Scratch memory from a per thread pool of arenas.
+ *
+ * An instance borrows an arena from the pool for the current thread and returns it when
+ * destroyed. A returned arena is reset but keeps a block as large as its peak use, up to
+ * @c MAX_BLOCK_SIZE, so that later use does not normally allocate. Memory from the arena is valid
+ * only while the instance exists.
+ */
+class ScratchArena
+{
+  using self_type = ScratchArena; ///< Self reference type.
+public:
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 4000;    ///< Initial block size.
+  static constexpr size_t MAX_BLOCK_SIZE     = 1 << 16; ///< Largest block kept for reuse.
+  static constexpr size_t MAX_POOLED         = 64;      ///< Maximum arenas pooled per thread.
+
+  ScratchArena(); ///< Borrow an arena.
+  ScratchArena(self_type &&that);
+  ScratchArena(self_type const &) = delete;
+  self_type &operator=(self_type const &) = delete;
+  ~ScratchArena(); ///< Return the arena.
+
+  /// @return The arena.
+  swoc::MemArena &operator*();
+
+  /// @return The arena.
+  swoc::MemArena *operator->();
+
+  /** Allocate a character buffer.
+   *
+   * @param n Number of characters.
+   * @return The buffer.
+   */
+  swoc::MemSpan<char> alloc(size_t n);
+
+  /** Copy @a text and add a terminating nul.
+   *
+   * @param text Text to copy.
+   * @return The copy, not including the nul.
+   */
+  swoc::TextView localize_c(swoc::TextView const &text);
+
+protected:
+  struct Entry;           ///< Pooled arena.
+  Entry *_entry = nullptr; ///< Borrowed arena.
+};
 
 template <typename... Args>
 void
@@ -43,8 +101,8 @@ DebugMsg(swoc::TextView fmt, Args &&... args)
     TSDebug("txn_box", "%.*s", int(w.size()), w.data());
   } else {
     // Do it the hard way.
-    std::vector<char> buff;
-    buff.resize(w.extent());
+    ScratchArena scratch;
+    auto buff = scratch.alloc(w.extent());
     swoc::FixedBufferWriter fw(buff.data(), buff.size());
     fw.print_v(fmt, arg_pack);
     TSDebug("txn_box", "%.*s", int(fw.size()), fw.data());
@@ -163,6 +221,58 @@ HeapObject::clear()
 
 class HttpHeader;
 
+/** Changes to the components of a URL.
+ *
+ * Only components which are set are updated, the rest are left unchanged.
+ *
+ * @see URL::update
+ * @see HttpRequest::url_update
+ */
+struct URLUpdate {
+  using self_type = URLUpdate; ///< Self reference type.
+
+  std::optional<swoc::TextView> _scheme; ///< New scheme.
+  std::optional<swoc::TextView> _host;   ///< New host.
+  std::optional<in_port_t> _port;        ///< New port.
+  std::optional<swoc::TextView> _path;   ///< New path.
+  std::optional<swoc::TextView> _query;  ///< New query.
+
+  self_type &
+  scheme(swoc::TextView text)
+  {
+    _scheme = text;
+    return *this;
+  }
+
+  self_type &
+  host(swoc::TextView text)
+  {
+    _host = text;
+    return *this;
+  }
+
+  self_type &
+  port(in_port_t port)
+  {
+    _port = port;
+    return *this;
+  }
+
+  self_type &
+  path(swoc::TextView text)
+  {
+    _path = text;
+    return *this;
+  }
+
+  self_type &
+  query(swoc::TextView text)
+  {
+    _query = text;
+    return *this;
+  }
+};
+
 /// A URL object.
 class URL : public HeapObject
 {
@@ -243,6 +353,16 @@ public:
 
   self_type &query_set(swoc::TextView text);
   self_type &fragment_set(swoc::TextView text);
+
+  /** Update several components at once.
+   *
+   * @param update Components to change.
+   * @return The number of components changed.
+   *
+   * A component is only set if it differs from the current value. The scheme and host are
+   * compared case insensitively. No parsing is done.
+   */
+  unsigned update(URLUpdate const &update);
 };
 
 class HttpField : public HeapObject
@@ -413,6 +533,17 @@ public:
    */
   bool url_set(swoc::TextView text);
 
+  /** Update several components of the URL at once.
+   *
+   * @param update Components to change.
+   * @return The number of components changed.
+   *
+   * This is cheaper than @c url_set as only components that differ from the current values are
+   * changed, and there is no parsing. Host and port changes are done as for @c host_set and
+   * @c port_set, therefore the @c Host field is kept consistent.
+   */
+  unsigned url_update(URLUpdate const &update);
+
   /** Set the @a host for the request.
    *
    * @param host Host for request.
@@ -457,6 +588,124 @@ public:
   bool reason_set(swoc::TextView reason);
 };
 
+class TxnConfigVar
+{
+  using self_type = TxnConfigVar; ///< Self reference type.
+public:
+  TxnConfigVar(swoc::TextView const &name, TSOverridableConfigKey key, TSRecordDataType type);
+
+  swoc::TextView
+  name() const
+  {
+    return _name;
+  }
+
+  TSOverridableConfigKey
+  key() const
+  {
+    return _key;
+  }
+
+  TSRecordDataType
+  type() const
+  {
+    return _ts_type;
+  }
+
+  bool is_valid(intmax_t) const { return _ts_type == TS_RECORDDATATYPE_INT; }
+
+  bool
+  is_valid(swoc::TextView const &) const
+  {
+    return _ts_type == TS_RECORDDATATYPE_STRING;
+  }
+
+  bool
+  is_valid(double) const
+  {
+    return _ts_type == TS_RECORDDATATYPE_FLOAT;
+  }
+
+  template <typename T> bool is_valid(typename std::decay<T>::type) { return false; }
+
+protected:
+  std::string _name;           ///< Name.
+  TSOverridableConfigKey _key; ///< override index value.
+  TSRecordDataType _ts_type{TS_RECORDDATATYPE_NULL};
+};
+
+/** Result of a transaction path call.
+ *
+ * This is a code and the context needed to describe it, without allocating or formatting. The
+ * message is formatted only if requested, via @c errata or printing.
+ */
+class Status
+{
+  using self_type = Status; ///< Self reference type.
+public:
+  /// Result codes.
+  enum Code : uint8_t {
+    OK = 0,           ///< Success.
+    INVALID_VALUE,    ///< Value is not the type of the variable.
+    INVALID_TYPE,     ///< Variable does not have a supported type.
+    ASSIGN_FAILED,    ///< TS rejected the assignment.
+    FETCH_FAILED,     ///< TS failed to provide the value.
+    CACHE_KEY_FAILED, ///< TS rejected the cache key.
+    ARG_FAILED,       ///< Failed to reserve a user argument index.
+  };
+
+  Status() = default; ///< Success.
+
+  /** Construct with a @a code and context.
+   *
+   * @param code Result code.
+   * @param var Variable, if any.
+   * @param value Value, if any.
+   *
+   * @a var and @a value must outlive @a this if the message is to be formatted.
+   */
+  Status(Code code, TxnConfigVar const *var = nullptr, ConfVarData const &value = {}) : _code(code), _var(var), _value(value) {}
+
+  /// @return @c true if the call succeeded.
+  bool
+  is_ok() const
+  {
+    return _code == OK;
+  }
+
+  /// @return @c true if the call succeeded.
+  explicit operator bool() const { return this->is_ok(); }
+
+  /// @return The result code.
+  Code
+  code() const
+  {
+    return _code;
+  }
+
+  /// @return The variable for the call, if any.
+  TxnConfigVar const *
+  var() const
+  {
+    return _var;
+  }
+
+  /// @return The value for the call, if any.
+  ConfVarData const &
+  value() const
+  {
+    return _value;
+  }
+
+  /// @return An @c Errata with the formatted message, or an empty one if successful.
+  swoc::Errata errata() const;
+
+protected:
+  Code _code               = OK;      ///< Result code.
+  TxnConfigVar const *_var = nullptr; ///< Variable, for messages.
+  ConfVarData _value;                 ///< Value, for messages.
+};
+
 /** Wrapper for a TS C API session.
  *
  */
@@ -507,56 +756,121 @@ public:
    */
   SSLContext ssl_context() const;
 
-protected:
-  TSHttpSsn _ssn = nullptr; ///< Session handle.
+  /// Classification of the remote address.
+  enum class AddrClass : uint8_t {
+    INVALID,  ///< No valid address.
+    LOOPBACK, ///< Loopback address.
+    PRIVATE,  ///< Private network address.
+    PUBLIC    ///< Any other address.
+  };
 
-  HttpSsn(TSHttpSsn ssn) : _ssn(ssn) {}
-};
+  /** Reserve the session argument for session local storage.
+   *
+   * @return Result of the call.
+   *
+   * This should be called during plugin initialization, before session storage or the compute once
+   * accessors are used. It is harmless to call more than once. If it has not been called, it is
+   * called on first use of the storage, and failure then is fatal.
+   *
+   * Session storage is released when the session closes. For HTTP/2 and HTTP/3 the transactions
+   * of a session can run concurrently, therefore session storage is locked. The slot, finalizer,
+   * and compute once methods lock internally. The arena does not - see @c arena.
+   */
+  static Status storage_init();
 
-class TxnConfigVar
-{
-  using self_type = TxnConfigVar; ///< Self reference type.
-public:
-  TxnConfigVar(swoc::TextView const &name, TSOverridableConfigKey key, TSRecordDataType type);
+  /** Reserve a session slot.
+   *
+   * @param[out] idx Slot index.
+   * @return Result of the call.
+   *
+   * @see HttpTxn::slot_reserve
+   */
+  static Status slot_reserve(unsigned &idx);
 
-  swoc::TextView
-  name() const
-  {
-    return _name;
-  }
+  /// @return The value of slot @a idx, or @c nullptr if not set.
+  void *slot(unsigned idx);
 
-  TSOverridableConfigKey
-  key() const
-  {
-    return _key;
-  }
+  /// Set slot @a idx to @a value.
+  void slot_assign(unsigned idx, void *value);
 
-  TSRecordDataType
-  type() const
-  {
-    return _ts_type;
-  }
+  /** Memory arena local to the session.
+   *
+   * @return The arena.
+   *
+   * Allocation from the arena must be done while holding the session lock.
+   *
+   * @code
+   *   auto lock = ssn.lock();
+   *   auto span = ssn.arena().alloc(n);
+   * @endcode
+   *
+   * @see lock
+   */
+  swoc::MemArena &arena();
 
-  bool is_valid(intmax_t) const { return _ts_type == TS_RECORDDATATYPE_INT; }
+  /** Lock the session storage.
+   *
+   * @return The lock, which is recursive.
+   *
+   * This is needed to allocate from @c arena, or to do a sequence of slot operations atomically.
+   */
+  std::unique_lock<std::recursive_mutex> lock();
 
-  bool
-  is_valid(swoc::TextView const &) const
-  {
-    return _ts_type == TS_RECORDDATATYPE_STRING;
-  }
+  /// Call @a f with @a obj when the session closes.
+  void finalizer_add(void (*f)(void *), void *obj);
 
-  bool
-  is_valid(double) const
-  {
-    return _ts_type == TS_RECORDDATATYPE_FLOAT;
-  }
+  /** The inbound SNI name, computed once per session.
+   *
+   * @return The SNI name, or an empty view if there is none.
+   */
+  swoc::TextView sni();
 
-  template <typename T> bool is_valid(typename std::decay<T>::type) { return false; }
+  /** The protocol stack, computed once per session.
+   *
+   * @return The protocol tags.
+   */
+  swoc::MemSpan<char const *> protocol_tags();
+
+  /** Value in the client certificate subject, computed once per session.
+   *
+   * @param nid Field identifier.
+   * @return The value, or an empty view if not found.
+   *
+   * @see ssl_nid
+   */
+  swoc::TextView remote_subject_field(int nid);
+
+  /** Value in the client certificate issuer, computed once per session.
+   *
+   * @param nid Field identifier.
+   * @return The value, or an empty view if not found.
+   *
+   * @see ssl_nid
+   */
+  swoc::TextView remote_issuer_field(int nid);
+
+  /// @return The class of the remote address, computed once per session.
+  AddrClass addr_remote_class();
 
 protected:
-  std::string _name;           ///< Name.
-  TSOverridableConfigKey _key; ///< override index value.
-  TSRecordDataType _ts_type{TS_RECORDDATATYPE_NULL};
+  TSHttpSsn _ssn = nullptr; ///< Session handle.
+
+  static std::atomic<int> _arg_idx;         ///< Session argument for the storage.
+  static std::atomic<unsigned> _slot_count; ///< Number of reserved slots.
+  static unsigned _cache_slot;              ///< Slot for the compute once values.
+
+  struct Cache; ///< Compute once values.
+
+  HttpSsn(TSHttpSsn ssn) : _ssn(ssn) {}
+
+  /// @return The storage for this session, creating it if needed.
+  LocalStorage *storage();
+
+  /// @return The compute once values for this session.
+  Cache &cache();
+
+  /// @return The client certificate field @a nid, from the cache if present.
+  swoc::TextView remote_cert_field(int nid, bool issuer_p);
 };
 
 /** Wrapper for a TS C API transaction.
@@ -593,6 +907,12 @@ public:
    */
   bool is_internal() const;
 
+  /** Has the transaction been aborted?
+   *
+   * @return @c true if the transaction was aborted by either the client or the server.
+   */
+  bool is_aborted() const;
+
   /** The effective URL for the transaction.
    *
    * @return The effective URL of the user agent request.
@@ -631,9 +951,20 @@ public:
    *
    * @param key Cache key for the retrieved object.
    * @return Errors, if any.
+   *
+   * @see CacheKeyTemplate for building the key from the transaction.
    */
   swoc::Errata cache_key_assign(swoc::TextView const &key);
 
+  /** Set the cache @a key for the transaction.
+   *
+   * @param key Cache key for the retrieved object.
+   * @return Result of the call.
+   *
+   * This is @c cache_key_assign without constructing an @c Errata.
+   */
+  Status cache_key_set(swoc::TextView const &key);
+
   /// @return The session object for @a this transaction.
   HttpSsn ssn() const;
 
@@ -674,15 +1005,62 @@ public:
    */
   swoc::Errata override_assign(TxnConfigVar const &var, double f);
 
+  /** Set @a n in the integer transaction overridable configuration @a var.
+   *
+   * @param var Overridable variable.
+   * @param n Value to assign.
+   * @return Result of the call.
+   *
+   * These are the @c override_assign methods without constructing an @c Errata. A failure message
+   * is formatted only if @c Status::errata is called.
+   */
+  Status override_set(TxnConfigVar const &var, intmax_t n);
+
+  /// Set @a text in the string transaction overridable configuration @a var.
+  Status override_set(TxnConfigVar const &var, swoc::TextView const &text);
+
+  /// Set @a f in the floating transaction overridable configuration @a var.
+  Status override_set(TxnConfigVar const &var, double f);
+
   swoc::Rv<ConfVarData> override_fetch(TxnConfigVar const &var);
 
+  /** Fetch the value of the transaction overridable configuration @a var.
+   *
+   * @param var Overridable variable.
+   * @param[out] value The value.
+   * @return Result of the call.
+   */
+  Status override_fetch(TxnConfigVar const &var, ConfVarData &value);
+
   /** Look up the transaction overridable configuration variable @a name.
    *
    * @param name Variable name.
    * @return The variable, or @a nullptr if @a name is not found to be a valid.
+   *
+   * Lookup of a variable that has been found before does not lock. Names which are preloaded are
+   * found with a single perfect hash probe.
+   *
+   * @see preload_overrides
    */
   static TxnConfigVar *find_override(swoc::TextView const &name);
 
+  /** Look up the transaction overridable configuration variable by @a key.
+   *
+   * @param key Variable key.
+   * @return The variable, or @a nullptr if @a key was not preloaded.
+   *
+   * This is an array index, there is no string handling.
+   */
+  static TxnConfigVar *find_override(TSOverridableConfigKey key);
+
+  /** Preload the known overridable configuration variables.
+   *
+   * The variables in a compiled in table are verified against TS and made available by key and by
+   * name. This should be called from plugin initialization. It is also called on demand, but only
+   * the first call does any work.
+   */
+  static void preload_overrides();
+
   /** Retrieve transaction arg @a idx
    *
    * @param idx Index of argument.
@@ -699,33 +1077,120 @@ public:
 
   static swoc::Rv<int> reserve_arg(swoc::TextView const &name, swoc::TextView const &description);
 
-  /** Gets the number of transactions between the Traffic Server proxy and the
-   *  origin server from a single session. Any value greater than zero indicates connection reuse.
+  /** Reserve a transaction argument index.
    *
-   * @return int The number of transaction
+   * @param name Name of the argument.
+   * @param description Description of the argument.
+   * @param[out] idx The index.
+   * @return Result of the call.
    */
-  int outbound_txn_count() const;
+  static Status reserve_arg(swoc::TextView const &name, swoc::TextView const &description, int &idx);
 
-  /** The file descriptor for the inbound connection.
+  /** Reserve the transaction argument for transaction local storage.
    *
-   * @return The file descriptor, or a negative value if not available.
+   * @return Result of the call.
+   *
+   * This should be called during plugin initialization, before @c arena, @c finalizer_add, or
+   * slots are used. It is called by @c slot_reserve and it is harmless to call more than once. If
+   * it has not been called, it is called on first use of the storage, and failure then is fatal.
    */
-  int inbound_fd() const;
-
-protected:
-  using TxnConfigVarTable = std::unordered_map<swoc::TextView, std::unique_ptr<TxnConfigVar>, std::hash<std::string_view>>;
+  static Status storage_init();
 
-  TSHttpTxn _txn = nullptr;
-  static TxnConfigVarTable _var_table;
-  static std::mutex _var_table_lock;
-  static int _arg_idx;
-
-  /** Duplicate a string into TS owned memory.
+  /** Reserve a transaction slot.
    *
-   * @param text String to duplicate.
-   * @return The duplicated string.
+   * @param[out] idx Slot index.
+   * @return Result of the call.
+   *
+   * Slots are a table of pointers in the transaction storage, all of which share the single TS
+   * argument reserved by @c storage_init. This should be called during plugin initialization.
+   *
+   * @see TxnSlot
    */
-  swoc::MemSpan<char> ts_dup(swoc::TextView const &text);
+  static Status slot_reserve(unsigned &idx);
+
+  /** Get the value of slot @a idx.
+   *
+   * @param idx Slot index.
+   * @return The value, or @c nullptr if not set.
+   */
+  void *slot(unsigned idx);
+
+  /** Set the value of slot @a idx.
+   *
+   * @param idx Slot index.
+   * @param value Value to set.
+   */
+  void slot_assign(unsigned idx, void *value);
+
+  /** Memory arena local to the transaction.
+   *
+   * @return The arena.
+   *
+   * The arena is borrowed from @c ScratchArena on first use and returned when the transaction
+   * closes, and so this does not normally allocate.
+   */
+  swoc::MemArena &arena();
+
+  /** Call @a f with @a obj when the transaction closes.
+   *
+   * @param f Finalizer.
+   * @param obj Argument for @a f.
+   *
+   * Finalizers are called in the reverse order they were added, before the arena is released.
+   */
+  void finalizer_add(void (*f)(void *), void *obj);
+
+  /** Gets the number of transactions between the Traffic Server proxy and the
+   *  origin server from a single session. Any value greater than zero indicates connection reuse.
+   *
+   * @return int The number of transaction
+   */
+  int outbound_txn_count() const;
+
+  /** The file descriptor for the inbound connection.
+   *
+   * @return The file descriptor, or a negative value if not available.
+   */
+  int inbound_fd() const;
+
+protected:
+  /** Table of known variables.
+   *
+   * A table is immutable once published. Adding a variable makes a copy with the variable added,
+   * and that replaces the current table. The variables are owned by @a _var_store so that the
+   * pointers are shared between tables.
+   */
+  using TxnConfigVarTable = std::unordered_map<swoc::TextView, TxnConfigVar *, std::hash<std::string_view>>;
+
+  TSHttpTxn _txn = nullptr;
+  static std::atomic<TxnConfigVarTable const *> _var_table; ///< Current table, read without locking.
+  static std::mutex _var_table_lock;                         ///< Serialize table updates.
+  /// Variable storage.
+  static std::vector<std::unique_ptr<TxnConfigVar>> _var_store;
+  /// Replaced tables, kept because readers may still be using them. This is bounded by the number
+  /// of overridable variables.
+  static std::vector<std::unique_ptr<TxnConfigVarTable const>> _var_table_retired;
+  /// Preloaded variables by key.
+  static std::array<TxnConfigVar *, TS_CONFIG_LAST_ENTRY> _var_by_key;
+  /// Preloaded variables by name, collision free for @a _var_phash_seed.
+  static std::vector<TxnConfigVar *> _var_phash;
+  static uint64_t _var_phash_seed; ///< Seed for @a _var_phash.
+  static std::once_flag _var_preload_flag; ///< Preload only once.
+
+  /// @return Hash of @a name for the preloaded table.
+  static uint64_t var_phash(swoc::TextView const &name, uint64_t seed);
+  static std::atomic<int> _arg_idx;         ///< Transaction argument for the storage.
+  static std::atomic<unsigned> _slot_count; ///< Number of reserved slots.
+
+  /// @return The storage for this transaction, creating it if needed.
+  LocalStorage *storage();
+
+  /** Duplicate a string into TS owned memory.
+   *
+   * @param text String to duplicate.
+   * @return The duplicated string.
+   */
+  swoc::MemSpan<char> ts_dup(swoc::TextView const &text);
 
   static void config_bool_record(swoc::Errata &errata, swoc::TextView name);
 
@@ -736,6 +1201,346 @@ protected:
   static void config_string_record(swoc::Errata &errata, swoc::TextView name);
 };
 
+/** A set of overridable configuration assignments.
+ *
+ * This is built and type checked at configuration load. Applying it to a transaction is then a
+ * single call which does only the TS API calls. If a variable is added more than once, the last
+ * value is used.
+ */
+class OverrideBundle
+{
+  using self_type = OverrideBundle; ///< Self reference type.
+public:
+  OverrideBundle() = default;
+
+  /** Add an integer assignment.
+   *
+   * @param var Variable.
+   * @param n Value.
+   * @return Errors, if any.
+   */
+  swoc::Errata add(TxnConfigVar const &var, intmax_t n);
+
+  /** Add a floating point assignment.
+   *
+   * @param var Variable.
+   * @param f Value.
+   * @return Errors, if any.
+   */
+  swoc::Errata add(TxnConfigVar const &var, double f);
+
+  /** Add a string assignment.
+   *
+   * @param var Variable.
+   * @param text Value. This is copied.
+   * @return Errors, if any.
+   */
+  swoc::Errata add(TxnConfigVar const &var, swoc::TextView const &text);
+
+  /** Apply the assignments.
+   *
+   * @param txn Transaction.
+   * @return The number of assignments which failed.
+   */
+  unsigned apply(HttpTxn &txn) const;
+
+  /// @return The number of assignments.
+  size_t
+  count() const
+  {
+    return _items.size();
+  }
+
+protected:
+  /// An assignment.
+  struct Item {
+    TSOverridableConfigKey _key;
+    TSRecordDataType _type;
+    intmax_t _n = 0;       ///< Integer value.
+    double _f   = 0;       ///< Floating value.
+    swoc::TextView _text;  ///< String value.
+  };
+
+  swoc::MemArena _arena{256}; ///< String value storage.
+  std::vector<Item> _items;   ///< Assignments.
+
+  /// @return The item for @a var, creating it if needed.
+  Item &item(TxnConfigVar const &var);
+};
+
+/** A transaction overridable configuration variable of a specific type.
+ *
+ * @tparam T Value type - @c intmax_t, @c double, or @c swoc::TextView.
+ *
+ * The type is checked once, when the handle is resolved. After that @c assign and @c fetch are
+ * just the TS API call, with no type dispatch.
+ */
+template <typename T> class TypedTxnConfigVar
+{
+  using self_type = TypedTxnConfigVar; ///< Self reference type.
+  static_assert(std::is_same_v<T, intmax_t> || std::is_same_v<T, double> || std::is_same_v<T, swoc::TextView>,
+                "TypedTxnConfigVar must be intmax_t, double, or swoc::TextView");
+
+public:
+  /// TS type for @a T.
+  static constexpr TSRecordDataType TS_TYPE = std::is_same_v<T, intmax_t> ? TS_RECORDDATATYPE_INT
+                                              : std::is_same_v<T, double> ? TS_RECORDDATATYPE_FLOAT
+                                                                          : TS_RECORDDATATYPE_STRING;
+
+  TypedTxnConfigVar() = default; ///< Construct an invalid handle.
+
+  /** Resolve a handle for @a var.
+   *
+   * @param var Variable.
+   * @return The handle, or errors if @a var is not of type @a T.
+   */
+  static swoc::Rv<self_type>
+  resolve(TxnConfigVar const &var)
+  {
+    if (var.type() != TS_TYPE) {
+      return swoc::Errata(S_ERROR, R"(Transaction overridable configuration variable "{}" is type {} not {}.)", var.name(), var.type(),
+                          TS_TYPE);
+    }
+    return self_type{&var};
+  }
+
+  /** Resolve a handle for the variable @a name.
+   *
+   * @param name Variable name.
+   * @return The handle, or errors if @a name is not a variable of type @a T.
+   */
+  static swoc::Rv<self_type>
+  resolve(swoc::TextView const &name)
+  {
+    if (auto var = HttpTxn::find_override(name); var != nullptr) {
+      return resolve(*var);
+    }
+    return swoc::Errata(S_ERROR, R"("{}" is not a transaction overridable configuration variable.)", name);
+  }
+
+  /// @return @c true if this is a resolved handle.
+  bool
+  is_valid() const
+  {
+    return _var != nullptr;
+  }
+
+  /// @return The variable.
+  TxnConfigVar const *
+  var() const
+  {
+    return _var;
+  }
+
+  /** Assign @a value to the variable in @a txn.
+   *
+   * @return @c true on success, @c false on failure.
+   */
+  bool
+  assign(HttpTxn &txn, T value) const
+  {
+    if constexpr (std::is_same_v<T, intmax_t>) {
+      return TS_SUCCESS == TSHttpTxnConfigIntSet(txn, _key, value);
+    } else if constexpr (std::is_same_v<T, double>) {
+      return TS_SUCCESS == TSHttpTxnConfigFloatSet(txn, _key, value);
+    } else {
+      return TS_SUCCESS == TSHttpTxnConfigStringSet(txn, _key, value.data(), value.size());
+    }
+  }
+
+  /** Fetch the value of the variable in @a txn.
+   *
+   * @param[out] value The value.
+   * @return @c true on success, @c false on failure.
+   */
+  bool
+  fetch(HttpTxn &txn, T &value) const
+  {
+    if constexpr (std::is_same_v<T, intmax_t>) {
+      TSMgmtInt n;
+      if (TS_SUCCESS == TSHttpTxnConfigIntGet(txn, _key, &n)) {
+        value = n;
+        return true;
+      }
+    } else if constexpr (std::is_same_v<T, double>) {
+      TSMgmtFloat f;
+      if (TS_SUCCESS == TSHttpTxnConfigFloatGet(txn, _key, &f)) {
+        value = f;
+        return true;
+      }
+    } else {
+      char const *text;
+      int len;
+      if (TS_SUCCESS == TSHttpTxnConfigStringGet(txn, _key, &text, &len)) {
+        value = swoc::TextView{text, static_cast<size_t>(len)};
+        return true;
+      }
+    }
+    return false;
+  }
+
+protected:
+  TxnConfigVar const *_var    = nullptr;                    ///< Variable.
+  TSOverridableConfigKey _key = TSOverridableConfigKey(-1); ///< Cached key for @a _var.
+
+  explicit TypedTxnConfigVar(TxnConfigVar const *var) : _var(var), _key(var->key()) {}
+};
+
+using TxnConfigInteger = TypedTxnConfigVar<intmax_t>;       ///< Integer overridable variable.
+using TxnConfigFloat   = TypedTxnConfigVar<double>;         ///< Floating overridable variable.
+using TxnConfigString  = TypedTxnConfigVar<swoc::TextView>; ///< String overridable variable.
+
+/** Typed local slot.
+ *
+ * @tparam O Owner type, @c HttpTxn or @c HttpSsn.
+ * @tparam T Type of object referenced by the slot.
+ *
+ * This is a handle for a pointer in every owner instance. The slot does not own the object.
+ *
+ * @see HttpTxn::slot_reserve
+ */
+template <typename O, typename T> class LocalSlot
+{
+  using self_type = LocalSlot; ///< Self reference type.
+public:
+  LocalSlot() = default;
+
+  /** Reserve the slot.
+   *
+   * @return Result of the call.
+   */
+  Status
+  init()
+  {
+    return O::slot_reserve(_idx);
+  }
+
+  /** Get the value for @a owner.
+   *
+   * @param owner Transaction or session.
+   * @return The value, or @c nullptr if not set.
+   */
+  T *
+  get(O &owner) const
+  {
+    return static_cast<T *>(owner.slot(_idx));
+  }
+
+  /** Set the value for @a owner.
+   *
+   * @param owner Transaction or session.
+   * @param value Value to set.
+   */
+  void
+  assign(O &owner, T *value) const
+  {
+    owner.slot_assign(_idx, value);
+  }
+
+  /// @return The slot index.
+  unsigned
+  index() const
+  {
+    return _idx;
+  }
+
+protected:
+  unsigned _idx = std::numeric_limits<unsigned>::max(); ///< Slot index.
+};
+
+template <typename T> using TxnSlot = LocalSlot<HttpTxn, T>; ///< Transaction slot.
+template <typename T> using SsnSlot = LocalSlot<HttpSsn, T>; ///< Session slot.
+
+/** Typed local context.
+ *
+ * @tparam O Owner type, @c HttpTxn or @c HttpSsn.
+ * @tparam T Context type.
+ *
+ * The context object is allocated in the owner arena and destroyed when the owner closes. An
+ * instance should be created and initialized during plugin initialization, after which it is a
+ * handle for the context in any owner instance.
+ *
+ * @code
+ *   static TxnContext<Data> Ctx;
+ *   // in TSPluginInit
+ *   Ctx.init();
+ *   // in a hook
+ *   auto &data = Ctx.obtain(txn, arg1, arg2);
+ * @endcode
+ */
+template <typename O, typename T> class LocalContext
+{
+  using self_type = LocalContext; ///< Self reference type.
+public:
+  LocalContext() = default;
+
+  /** Reserve the slot for the context.
+   *
+   * @return Result of the call.
+   */
+  Status
+  init()
+  {
+    return _slot.init();
+  }
+
+  /** Get the context for @a owner.
+   *
+   * @param owner Transaction or session.
+   * @return The context, or @c nullptr if it has not been created.
+   */
+  T *
+  get(O &owner) const
+  {
+    return _slot.get(owner);
+  }
+
+  /** Get the context for @a owner, creating it if needed.
+   *
+   * @param owner Transaction or session.
+   * @param args Constructor arguments, used only if the context is created.
+   * @return The context.
+   */
+  template <typename... Args>
+  T &
+  obtain(O &owner, Args &&... args)
+  {
+    std::unique_lock<std::recursive_mutex> lock;
+    if constexpr (std::is_same_v<O, HttpSsn>) { // Transactions of a session can run concurrently.
+      lock = owner.lock();
+    }
+    if (auto ctx = this->get(owner); ctx != nullptr) {
+      return *ctx;
+    }
+    auto ctx = owner.arena().template make<T>(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      owner.finalizer_add(&self_type::destroy, ctx);
+    }
+    _slot.assign(owner, ctx);
+    return *ctx;
+  }
+
+  /// @return The slot index.
+  unsigned
+  index() const
+  {
+    return _slot.index();
+  }
+
+protected:
+  LocalSlot<O, T> _slot; ///< Slot for the context.
+
+  /// Finalizer for the context.
+  static void
+  destroy(void *ctx)
+  {
+    static_cast<T *>(ctx)->~T();
+  }
+};
+
+template <typename T> using TxnContext = LocalContext<HttpTxn, T>; ///< Transaction context.
+template <typename T> using SsnContext = LocalContext<HttpSsn, T>; ///< Session context.
+
 /// An SSL context for a session.
 class SSLContext
 {
@@ -816,26 +1621,621 @@ void Log_Warning(swoc::TextView const &text);
 void Log_Error(swoc::TextView const &text);
 // ----
 
-struct TaskHandle {
-  /// Wrapper for data needed when the event is dispatched.
-  struct Data {
-    std::function<void()> _f;         ///< Functor to dispatch.
-    std::atomic<bool> _active = true; ///< Set @c false if the task has been canceled.
+/** Type erased task callable with inline storage.
+ *
+ * A callable no larger than @c INLINE_SIZE is stored in the instance, so wrapping a typical lambda
+ * does not allocate. Larger callables are heap allocated.
+ */
+class TaskFunction
+{
+  using self_type = TaskFunction; ///< Self reference type.
+public:
+  static constexpr size_t INLINE_SIZE = 48; ///< Inline storage size.
+
+  TaskFunction() = default; ///< Construct an empty instance.
+
+  /// Construct from the callable @a f.
+  template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, self_type>>> TaskFunction(F &&f);
+
+  TaskFunction(self_type &&that);
+  self_type &operator=(self_type &&that);
+  TaskFunction(self_type const &) = delete;
+  self_type &operator=(self_type const &) = delete;
+  ~TaskFunction();
+
+  /// Invoke the callable.
+  void
+  operator()()
+  {
+    _vt->_invoke(_store);
+  }
+
+  /// @return @c true if there is a callable.
+  explicit operator bool() const { return _vt != nullptr; }
+
+  /// Destroy the callable.
+  void reset();
+
+protected:
+  /// Operations for a specific callable type.
+  struct VTable {
+    void (*_invoke)(void *);             ///< Invoke the callable.
+    void (*_move)(void *dst, void *src); ///< Move construct in @a dst and destroy @a src.
+    void (*_destroy)(void *);            ///< Destroy the callable.
+  };
+
+  /// Operations for a callable in the inline storage.
+  template <typename F> struct Inline {
+    static constexpr VTable VT{[](void *p) { (*static_cast<F *>(p))(); },
+                               [](void *dst, void *src) {
+                                 new (dst) F(std::move(*static_cast<F *>(src)));
+                                 static_cast<F *>(src)->~F();
+                               },
+                               [](void *p) { static_cast<F *>(p)->~F(); }};
+  };
 
-    /// Construct from functor @a f.
-    Data(std::function<void()> &&f) : _f(std::move(f)) {}
+  /// Operations for a callable in the heap. The inline storage holds a pointer to it.
+  template <typename F> struct Heap {
+    static constexpr VTable VT{[](void *p) { (**static_cast<F **>(p))(); },
+                               [](void *dst, void *src) { *static_cast<F **>(dst) = *static_cast<F **>(src); },
+                               [](void *p) { delete *static_cast<F **>(p); }};
   };
 
-  TSAction _action = nullptr; ///< Internal handle returned from task scheduling.
-  TSCont _cont     = nullptr; ///< Continuation for @a _action.
+  alignas(std::max_align_t) unsigned char _store[INLINE_SIZE]; ///< Callable storage.
+  VTable const *_vt = nullptr;                                 ///< Operations for the callable.
+};
+
+template <typename F, typename> TaskFunction::TaskFunction(F &&f)
+{
+  using C = std::decay_t<F>;
+  if constexpr (sizeof(C) <= INLINE_SIZE && alignof(C) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<C>) {
+    new (_store) C(std::forward<F>(f));
+    _vt = &Inline<C>::VT;
+  } else {
+    *reinterpret_cast<C **>(_store) = new C(std::forward<F>(f));
+    _vt = &Heap<C>::VT;
+  }
+}
+
+inline TaskFunction::TaskFunction(self_type &&that)
+{
+  if (that._vt) {
+    that._vt->_move(_store, that._store);
+    _vt = std::exchange(that._vt, nullptr);
+  }
+}
+
+inline auto
+TaskFunction::operator=(self_type &&that) -> self_type &
+{
+  if (this != &that) {
+    this->reset();
+    if (that._vt) {
+      that._vt->_move(_store, that._store);
+      _vt = std::exchange(that._vt, nullptr);
+    }
+  }
+  return *this;
+}
+
+inline TaskFunction::~TaskFunction()
+{
+  this->reset();
+}
+
+inline void
+TaskFunction::reset()
+{
+  if (_vt) {
+    std::exchange(_vt, nullptr)->_destroy(_store);
+  }
+}
+
+/** Instrumentation for a named task.
+ *
+ * This records, as plugin stats, the number of runs, the queue delay (from when the task was due
+ * to when it started), the run time, and the number of overruns. The delays and run times are also
+ * counted in histogram buckets, one stat per bucket. For a task named "reload" with prefix
+ * "txn_box.task" the stats are
+ *
+ * - txn_box.task.reload.count
+ * - txn_box.task.reload.queue_delay_us - total
+ * - txn_box.task.reload.queue_delay.le_100us ... gt_1s
+ * - txn_box.task.reload.run_time_us - total
+ * - txn_box.task.reload.run_time.le_100us ... gt_1s
+ * - txn_box.task.reload.overrun
+ *
+ * A run is an overrun if the run time exceeds the budget, or if there is no budget, the period of
+ * a periodic task.
+ */
+class TaskStats
+{
+  using self_type = TaskStats; ///< Self reference type.
+public:
+  static constexpr size_t N_BUCKETS = 6; ///< Number of histogram buckets.
+  /// Upper limits of the histogram buckets. The last bucket has no limit.
+  static constexpr std::array<std::chrono::microseconds::rep, N_BUCKETS - 1> BUCKET_LIMITS = {100, 1'000, 10'000, 100'000,
+                                                                                              1'000'000};
+
+  /** Define the stats for a task.
+   *
+   * @param name Full name of the task, used as the stat name prefix.
+   * @param budget Run time budget, or zero for none.
+   * @return The stats for @a name.
+   *
+   * Defining the same name again returns the existing instance.
+   */
+  static swoc::Rv<self_type const *> define(swoc::TextView name,
+                                            std::chrono::milliseconds budget = std::chrono::milliseconds{0});
+
+  /** Record a run.
+   *
+   * @param queue_delay Time from due to start.
+   * @param run_time Time to run.
+   * @param period Period of the task, or zero if not periodic.
+   */
+  void record(std::chrono::microseconds queue_delay, std::chrono::microseconds run_time,
+              std::chrono::milliseconds period) const;
+
+protected:
+  int _count       = -1;                  ///< Stat index for the number of runs.
+  int _queue_delay = -1;                  ///< Stat index for the total queue delay.
+  int _run_time    = -1;                  ///< Stat index for the total run time.
+  int _overrun     = -1;                  ///< Stat index for the number of overruns.
+  std::array<int, N_BUCKETS> _queue_hist; ///< Stat indices for the queue delay buckets.
+  std::array<int, N_BUCKETS> _run_hist;   ///< Stat indices for the run time buckets.
+  std::chrono::milliseconds _budget;      ///< Run time budget.
+
+  /// @return The bucket for @a t.
+  static size_t bucket(std::chrono::microseconds t);
+};
+
+/** Handle for a scheduled task.
+ *
+ * Task continuations are pooled and reused. The handle records the generation of the task it was
+ * returned for, so that cancelling a task that has finished does not affect a later task that
+ * reuses the same continuation.
+ */
+struct TaskHandle {
+  struct Data; ///< Pooled task data.
+
+  TSAction _action     = nullptr; ///< Internal handle returned from task scheduling.
+  TSCont _cont         = nullptr; ///< Continuation for @a _action.
+  Data *_data          = nullptr; ///< Task data.
+  uint32_t _generation = 0;       ///< Generation of @a _data for this task.
 
   /// Cancel the task.
   void cancel();
 };
 
-TaskHandle PerformAsTask(std::function<void()> &&task);
+/** Run @a task once on the task thread pool.
+ *
+ * @param task Functor to run.
+ * @param stats Instrumentation, or @c nullptr for none.
+ * @return A handle for the task.
+ */
+TaskHandle PerformAsTask(TaskFunction &&task, TaskStats const *stats = nullptr);
+
+/** Run @a task every @a period on the task thread pool.
+ *
+ * @param task Functor to run.
+ * @param period Time between runs.
+ * @param stats Instrumentation, or @c nullptr for none.
+ * @return A handle for the task.
+ */
+TaskHandle PerformAsTaskEvery(TaskFunction &&task, std::chrono::milliseconds period, TaskStats const *stats = nullptr);
+
+/** Run @a task once after @a delay on the thread pool @a pool.
+ *
+ * @param task Functor to run.
+ * @param delay Delay before running.
+ * @param pool Thread pool.
+ * @return A handle for the task.
+ */
+TaskHandle PerformAsTaskAfter(TaskFunction &&task, std::chrono::milliseconds delay, TSThreadPool pool = TS_THREAD_POOL_TASK);
+
+/** Run @a task on the event thread @a thread.
+ *
+ * @param task Functor to run.
+ * @param thread Thread on which to run @a task.
+ * @param delay Delay before running.
+ * @return A handle for the task.
+ *
+ * This is for maintaining per thread data, such as thread local caches, without locking.
+ */
+TaskHandle PerformAsTaskOn(TaskFunction &&task, TSEventThread thread, std::chrono::milliseconds delay = std::chrono::milliseconds{0});
+
+/** Run the functors in @a tasks on the task thread pool, in a bounded number of dispatches.
+ *
+ * @param tasks Functors to run.
+ * @param n_dispatch Maximum number of dispatches.
+ * @param done Functor to run after every functor in @a tasks has run.
+ * @return The number of dispatches, zero only if nothing was scheduled.
+ *
+ * The functors are split into at most @a n_dispatch contiguous groups, each of which is run in
+ * order in a single task dispatch. This is for fanning out many small jobs, where scheduling each
+ * as a separate task would cost more than the jobs. @a done is run in the last group to finish, or
+ * if @a tasks is empty, in a dispatch of its own.
+ */
+unsigned PerformAsTaskBatch(std::vector<TaskFunction> &&tasks, unsigned n_dispatch = 1, TaskFunction &&done = {});
+
+/** A periodic task with an adaptive period.
+ *
+ * Each run of the functor returns an @c Outcome which determines the delay to the next run.
+ *
+ * - @c DONE - the next run is after the base period.
+ * - @c MORE - there is more work, the period is halved, down to the minimum period.
+ * - @c IDLE - there was no work, the period is doubled, up to the maximum period.
+ * - @c FAILED - the delay backs off exponentially from the base period, up to the maximum period.
+ *   The period is not changed, and the back off is reset by the next run that does not fail.
+ *
+ * The delay is randomized by the jitter fraction, so that tasks started together on many threads
+ * or hosts spread out. The randomized delay is kept within the minimum and maximum periods, and
+ * every delay is at least 1ms. The base period can be changed while the task is active. Runs do
+ * not overlap.
+ *
+ * Each run is a pooled one shot task, therefore no continuation is created after start up.
+ *
+ * @code
+ *   auto task = ts::AdaptiveTask::start([]() { return flush() ? ts::AdaptiveTask::DONE : ts::AdaptiveTask::FAILED; },
+ *                                       {std::chrono::seconds{10}, std::chrono::seconds{1}, std::chrono::minutes{5}, 0.1});
+ *   // ...
+ *   task->period_set(std::chrono::seconds{30});
+ *   // ...
+ *   task->cancel();
+ * @endcode
+ */
+class AdaptiveTask : public std::enable_shared_from_this<AdaptiveTask>
+{
+  using self_type = AdaptiveTask; ///< Self reference type.
+public:
+  /// Result of a run.
+  enum Outcome {
+    DONE,  ///< Normal.
+    MORE,  ///< More work to do.
+    IDLE,  ///< No work to do.
+    FAILED ///< The run failed.
+  };
+
+  using Function = std::function<Outcome()>; ///< Task functor.
+
+  /// Scheduling parameters.
+  struct Policy {
+    std::chrono::milliseconds _period;        ///< Base period.
+    std::chrono::milliseconds _min_period{0}; ///< Shortest period, zero for the base period.
+    std::chrono::milliseconds _max_period{0}; ///< Longest period and back off, zero for the base period.
+    double _jitter = 0;                       ///< Fraction of the delay to randomize, in [0,1].
+  };
+
+  /** Start a task.
+   *
+   * @param f Task functor.
+   * @param policy Scheduling parameters.
+   * @return The task.
+   *
+   * The first run is after the base period. The task stays active until canceled, even if the
+   * returned pointer is dropped.
+   */
+  static std::shared_ptr<self_type> start(Function &&f, Policy const &policy);
+
+  /** Change the base period.
+   *
+   * @param period New base period.
+   *
+   * This also resets the adaptive period. If the task is not running, the next run is rescheduled
+   * for the new period.
+   */
+  void period_set(std::chrono::milliseconds period);
+
+  /// @return The current base period.
+  std::chrono::milliseconds period() const;
+
+  /** Cancel the task. A run in progress finishes, but there are no more runs.
+   *
+   * This can be called from the functor.
+   */
+  void cancel();
+
+protected:
+  mutable std::mutex _lock;           ///< Lock for the members.
+  Function _f;                        ///< Task functor.
+  Policy _policy;                     ///< Scheduling parameters.
+  std::chrono::milliseconds _current; ///< Adaptive period.
+  unsigned _n_failures = 0;           ///< Consecutive failed runs.
+  uint64_t _seq        = 0;           ///< Sequence number of the scheduled run.
+  bool _running_p      = false;       ///< The functor is running.
+  bool _canceled_p     = false;       ///< The task has been canceled.
+  TaskHandle _handle;                 ///< Scheduled run.
+
+  AdaptiveTask(Function &&f, Policy const &policy);
+
+  /// Schedule the next run after @a delay, with jitter. @a _lock must be held.
+  void schedule(std::chrono::milliseconds delay);
+
+  /// Run the functor if @a seq is the scheduled run.
+  void run(uint64_t seq);
+};
+
+/** Register the current thread as a network thread which has plugin data.
+ *
+ * This should be called by plugin code which creates thread local data on an @c ET_NET thread.
+ * It is cheap to call after the first time on a thread. Threads are also registered when
+ * transaction or session local storage is created. This is only needed before ATS 10, which can
+ * schedule on every thread directly.
+ *
+ * @see PerformOnEveryNetThread
+ */
+void NetThreadRegister();
+
+/** Run @a f once on every network thread.
+ *
+ * @param f Functor to run.
+ * @param done Functor to run, on one of the threads, after @a f has run on every thread.
+ * @return The number of threads.
+ *
+ * This is intended for work such as clearing thread local caches after a configuration reload.
+ * With ATS 10 or later this runs on every @c ET_NET thread. Earlier versions do not provide a way
+ * to reach every event thread, therefore this runs on the threads registered by
+ * @c NetThreadRegister, and plugin code which keeps thread local data must register its threads.
+ */
+unsigned PerformOnEveryNetThread(std::function<void()> f, TaskFunction &&done = {});
+
+/** Shared state for @c Promise and @c Future.
+ *
+ * The result is delivered on the event thread that created the state, once there is both a result
+ * and a continuation to receive it.
+ */
+class FutureStateBase
+{
+  using self_type = FutureStateBase; ///< Self reference type.
+public:
+  FutureStateBase(); ///< Construct for the current thread.
+  virtual ~FutureStateBase() = default;
+
+protected:
+  std::mutex _lock;                ///< Serialize @a _value_p and @a _then_p.
+  TSEventThread _origin = nullptr; ///< Thread for delivery.
+  bool _value_p         = false;   ///< The result is available (or the promise was broken).
+  bool _then_p          = false;   ///< The continuation is set.
+
+  /** Mark the result (@a value_p) or the continuation as set.
+   *
+   * @param self The state.
+   * @param value_p @c true for the result, @c false for the continuation.
+   *
+   * If both are set, @c deliver is scheduled on the origin thread.
+   */
+  static void signal(std::shared_ptr<self_type> self, bool value_p);
+
+  /// Pass the result to the continuation.
+  virtual void deliver() = 0;
+};
+
+/** Shared state for a result of type @a R.
+ *
+ * @tparam R Result type.
+ */
+template <typename R> class FutureState : public FutureStateBase
+{
+  using self_type  = FutureState;     ///< Self reference type.
+  using super_type = FutureStateBase; ///< Parent type.
+public:
+  /// Continuation type - the result is empty if the promise was broken.
+  using Continuation = std::function<void(std::optional<R> &)>;
+
+  /** Set the result.
+   *
+   * @param self The state.
+   * @param value The result, or empty if the promise was broken.
+   */
+  static void
+  set_value(std::shared_ptr<self_type> self, std::optional<R> &&value)
+  {
+    self->_value = std::move(value);
+    super_type::signal(std::move(self), true);
+  }
+
+  /** Set the continuation.
+   *
+   * @param self The state.
+   * @param f The continuation.
+   */
+  static void
+  set_then(std::shared_ptr<self_type> self, Continuation &&f)
+  {
+    self->_then = std::move(f);
+    super_type::signal(std::move(self), false);
+  }
+
+protected:
+  std::optional<R> _value; ///< Result.
+  Continuation _then;      ///< Continuation.
+
+  void
+  deliver() override
+  {
+    _then(_value);
+    _then = nullptr;
+  }
+};
+
+template <typename R> class Promise;
+
+/** The future result of a background task.
+ *
+ * @tparam R Result type.
+ *
+ * The result is not retrieved by blocking. Instead a continuation is set with @c then, and that is
+ * called with the result on the event thread which created the promise.
+ */
+template <typename R> class Future
+{
+  using self_type = Future; ///< Self reference type.
+  friend class Promise<R>;
+
+public:
+  Future() = default;
+
+  /** Set the continuation for the result.
+   *
+   * @param f Continuation, called as @c f(std::optional<R>&).
+   *
+   * The result is empty if the promise was broken, such as when the task was canceled. This must be
+   * called at most once.
+   */
+  template <typename F>
+  void
+  then(F &&f)
+  {
+    FutureState<R>::set_then(std::move(_state), typename FutureState<R>::Continuation(std::forward<F>(f)));
+  }
 
-TaskHandle PerformAsTaskEvery(std::function<void()> &&task, std::chrono::milliseconds period);
+  /// @return @c true if the continuation can be set.
+  bool
+  is_valid() const
+  {
+    return _state != nullptr;
+  }
+
+protected:
+  std::shared_ptr<FutureState<R>> _state; ///< Shared state.
+
+  explicit Future(std::shared_ptr<FutureState<R>> state) : _state(std::move(state)) {}
+};
+
+/** The source of a future result.
+ *
+ * @tparam R Result type.
+ *
+ * This should be created on the event thread that is to receive the result. If it is destroyed
+ * without a value being set, the continuation is called with an empty result.
+ */
+template <typename R> class Promise
+{
+  using self_type = Promise; ///< Self reference type.
+  static_assert(!std::is_void_v<R>, "Promise result type must not be void");
+
+public:
+  Promise() : _state(std::make_shared<FutureState<R>>()) {}
+  Promise(self_type &&that) = default;
+  self_type &operator=(self_type &&that) = default;
+
+  ~Promise()
+  {
+    if (_state) {
+      FutureState<R>::set_value(std::move(_state), std::nullopt);
+    }
+  }
+
+  /// @return The future for this promise.
+  Future<R>
+  future() const
+  {
+    return Future<R>{_state};
+  }
+
+  /** Set the result.
+   *
+   * @param value Result.
+   *
+   * This must be called at most once.
+   */
+  void
+  set_value(R &&value)
+  {
+    FutureState<R>::set_value(std::move(_state), std::optional<R>{std::move(value)});
+  }
+
+protected:
+  std::shared_ptr<FutureState<R>> _state; ///< Shared state.
+};
+
+/** Run @a work as a task and deliver the result to the current thread.
+ *
+ * @param work Functor to run on a task thread.
+ * @return The future result of @a work.
+ *
+ * This is intended for offloading blocking work from a hook. If @a work throws, the result is
+ * empty.
+ *
+ * @code
+ *   PerformAsTaskFuture([path] { return load_file(path); }).then([txn](std::optional<std::string> &content) {
+ *     // ... use @a content on the original thread.
+ *     TSHttpTxnReenable(txn, TS_EVENT_HTTP_CONTINUE);
+ *   });
+ * @endcode
+ */
+template <typename F, typename R = std::invoke_result_t<F>>
+Future<R>
+PerformAsTaskFuture(F &&work)
+{
+  Promise<R> promise;
+  auto future = promise.future();
+  PerformAsTask([promise = std::move(promise), work = std::forward<F>(work)]() mutable {
+    try {
+      promise.set_value(work());
+    } catch (...) {
+      // Don't let the exception escape into the event loop. The promise is broken when the task is
+      // cleaned up, which delivers an empty result.
+    }
+  });
+  return future;
+}
+
+/** Run @a work as a task, then finish and reenable the transaction on the original thread.
+ *
+ * @param txn Transaction, which must be in a hook that has not been reenabled.
+ * @param work Functor to run on a task thread.
+ * @param finish Functor to run on the original thread.
+ *
+ * This is for doing blocking or expensive work for a transaction hook without stalling the event
+ * thread. The hook must return without reenabling @a txn, which is reenabled after @a finish.
+ * @a work runs on a task thread and must not use @a txn. @a finish is called on the event thread of
+ * the hook as @c finish(HttpTxn&, R&) where @c R is the result of @a work, or as
+ * @c finish(HttpTxn&) if @a work returns @c void. It can return the event for
+ * @c TSHttpTxnReenable, otherwise the event is @c TS_EVENT_HTTP_CONTINUE.
+ *
+ * The transaction does not progress until it is reenabled, so it stays valid. However it can be
+ * aborted meanwhile. In that case, or if @a work throws, @a finish is not called and the
+ * transaction is reenabled with @c TS_EVENT_HTTP_ERROR so it is cleaned up without further
+ * processing.
+ *
+ * @code
+ *   PerformAsTaskAndReenable(txn, [key] { return lookup(key); }, [](ts::HttpTxn &txn, Entry &entry) {
+ *     txn.prsp_hdr().field_obtain("X-Entry").assign(entry.value);
+ *   });
+ *   return 0; // Do not reenable here.
+ * @endcode
+ */
+template <typename W, typename F>
+void
+PerformAsTaskAndReenable(HttpTxn txn, W &&work, F &&finish)
+{
+  using R = std::invoke_result_t<W>;
+  if constexpr (std::is_void_v<R>) { // Futures need a value, use a placeholder.
+    PerformAsTaskAndReenable(
+      txn,
+      [work = std::forward<W>(work)]() mutable {
+        work();
+        return true;
+      },
+      [finish = std::forward<F>(finish)](HttpTxn &txn, bool) mutable { return finish(txn); });
+  } else {
+    static_assert(std::is_invocable_v<F &, HttpTxn &, R &>, "finish must be callable as finish(HttpTxn&, R&)");
+    PerformAsTaskFuture(std::forward<W>(work)).then([txn, finish = std::forward<F>(finish)](std::optional<R> &result) mutable {
+      TSEvent event = TS_EVENT_HTTP_ERROR;
+      if (result && !txn.is_aborted()) {
+        if constexpr (std::is_void_v<std::invoke_result_t<F &, HttpTxn &, R &>>) {
+          finish(txn, *result);
+          event = TS_EVENT_HTTP_CONTINUE;
+        } else {
+          event = finish(txn, *result);
+        }
+      }
+      TSHttpTxnReenable(txn, event);
+    });
+  }
+}
 
 inline HeapObject::HeapObject(TSMBuffer buff, TSMLoc loc) : _buff(buff), _loc(loc) {}
 
@@ -1001,6 +2401,7 @@ namespace swoc
 BufferWriter &bwformat(BufferWriter &w, bwf::Spec const &spec, TSHttpStatus status);
 BufferWriter &bwformat(BufferWriter &w, bwf::Spec const &spec, TSRecordDataType);
 BufferWriter &bwformat(BufferWriter &w, bwf::Spec const &spec, ts::ConfVarData const &);
+BufferWriter &bwformat(BufferWriter &w, bwf::Spec const &spec, ts::Status const &status);
 } // namespace swoc
 
 namespace std
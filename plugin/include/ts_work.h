@@ -0,0 +1,246 @@
+/** @file
+ * Work stealing thread pool for CPU heavy background work.
+ *
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ts
+{
+/** A pool of threads for fork / join parallel work.
+ *
+ * This is for work such as configuration parsing, index building, and sorting, done in the
+ * background, that would otherwise tie up a TS task thread. It is separate from the TS thread
+ * pools and does no TS API calls.
+ *
+ * Each worker has a Chase-Lev deque. Work spawned by a worker goes on its own deque, and idle
+ * workers steal from the other end of the deques of the other workers. Work spawned by a thread
+ * not in the pool goes on a shared queue. A thread waiting for spawned work runs other work while
+ * it waits, so nested parallelism does not deadlock.
+ *
+ * If the pool has no threads, which is the default, all work is done by the calling thread.
+ *
+ * @see parallel_invoke
+ * @see parallel_for
+ * @see parallel_sort
+ */
+class WorkPool
+{
+  using self_type = WorkPool; ///< Self reference type.
+public:
+  /// A unit of work. This is owned by the spawner, which must wait for it to finish.
+  struct Job {
+    void (*_run)(Job *)             = nullptr; ///< Do the work.
+    std::atomic<unsigned> *_pending = nullptr; ///< Decremented when the work is done.
+  };
+
+  /** Set the number of threads in the pool.
+   *
+   * @param n_threads Number of threads.
+   * @return @c true if the pool was created, @c false if it already exists.
+   *
+   * This should be called during plugin initialization, before any work is done. The pool is
+   * created only once - after that, either by this or by the first use of the pool, this does
+   * nothing.
+   */
+  static bool init(unsigned n_threads);
+
+  /// @return The pool.
+  static self_type &instance();
+
+  ~WorkPool();
+
+  /// @return The number of threads in the pool.
+  unsigned
+  size() const
+  {
+    return _workers.size();
+  }
+
+  /** Spawn @a job.
+   *
+   * @param job Job to run.
+   *
+   * @a job must remain valid until its pending count is decremented.
+   */
+  void spawn(Job *job);
+
+  /** Wait for @a pending to become zero, doing other work until then.
+   *
+   * @param pending Count of unfinished jobs.
+   */
+  void wait(std::atomic<unsigned> &pending);
+
+protected:
+  /** Chase-Lev work stealing deque.
+   *
+   * The owner pushes and pops at the bottom, thieves steal from the top. The capacity is fixed,
+   * if it is full the spawner runs the job itself.
+   */
+  class Deque
+  {
+  public:
+    static constexpr int64_t CAPACITY = 1024; ///< Maximum number of jobs, a power of 2.
+
+    /// Push @a job at the bottom - owner only.
+    bool push(Job *job);
+
+    /// @return The job at the bottom, or @c nullptr if empty - owner only.
+    Job *pop();
+
+    /// @return The job at the top, or @c nullptr if empty or there was a race.
+    Job *steal();
+
+  protected:
+    alignas(64) std::atomic<int64_t> _top{0};    ///< Steal index.
+    alignas(64) std::atomic<int64_t> _bottom{0}; ///< Push / pop index.
+    std::array<std::atomic<Job *>, CAPACITY> _jobs;
+  };
+
+  /// A pool thread.
+  struct Worker {
+    Deque _deque;        ///< Jobs spawned by this worker.
+    std::thread _thread; ///< The thread.
+  };
+
+  std::vector<std::unique_ptr<Worker>> _workers; ///< Pool threads.
+  std::mutex _inject_lock;                       ///< Lock for @a _inject.
+  std::deque<Job *> _inject;                     ///< Jobs spawned by threads not in the pool.
+  std::mutex _idle_lock;                         ///< Lock for @a _idle_cv.
+  std::condition_variable _idle_cv;              ///< Idle workers wait on this.
+  std::atomic<unsigned> _n_idle{0};              ///< Number of idle workers.
+  std::atomic<uint64_t> _n_spawned{0};           ///< Jobs spawned, idle workers wait for this to change.
+  std::atomic<bool> _stop_p{false};              ///< Workers should exit.
+
+  static std::unique_ptr<self_type> _instance; ///< The pool.
+  static std::once_flag _instance_once;        ///< Create @a _instance once.
+
+  explicit WorkPool(unsigned n_threads);
+
+  /// Worker thread loop.
+  void run(Worker *self);
+
+  /// @return A job to run, or @c nullptr if none was found.
+  Job *find(Worker *self);
+
+  /// Run @a job and mark it done.
+  static void execute(Job *job);
+};
+
+/** Run @a a and @a b in parallel.
+ *
+ * @param a Functor.
+ * @param b Functor.
+ *
+ * This returns after both have finished. If @a a throws, the exception is propagated after @a b
+ * has finished.
+ */
+template <typename A, typename B>
+void
+parallel_invoke(A &&a, B &&b)
+{
+  auto &pool = WorkPool::instance();
+  if (pool.size() == 0) {
+    a();
+    b();
+    return;
+  }
+
+  struct BJob : WorkPool::Job {
+    std::remove_reference_t<B> *_b;
+  };
+  std::atomic<unsigned> pending{1};
+  BJob job;
+  job._run     = [](WorkPool::Job *j) { (*static_cast<BJob *>(j)->_b)(); };
+  job._pending = &pending;
+  job._b       = &b;
+  pool.spawn(&job);
+  // @a job refers to this frame, therefore it must finish even if @a a throws.
+  struct Join {
+    WorkPool &_pool;
+    std::atomic<unsigned> &_pending;
+    ~Join() { _pool.wait(_pending); }
+  } join{pool, pending};
+  a();
+}
+
+/** Call @a f for each index in [ @a begin , @a end ) in parallel.
+ *
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param f Functor, called as @c f(size_t).
+ * @param grain Maximum indices in a sequential chunk, or 0 to choose based on the pool size.
+ */
+template <typename F>
+void
+parallel_for(size_t begin, size_t end, F &&f, size_t grain = 0)
+{
+  if (begin >= end) {
+    return;
+  }
+  if (grain == 0) {
+    grain = std::max<size_t>(1, (end - begin) / (8 * (WorkPool::instance().size() + 1)));
+  }
+  if (end - begin <= grain) {
+    for (auto idx = begin; idx < end; ++idx) {
+      f(idx);
+    }
+    return;
+  }
+  auto mid = begin + (end - begin) / 2;
+  parallel_invoke([&]() { parallel_for(begin, mid, f, grain); }, [&]() { parallel_for(mid, end, f, grain); });
+}
+
+/** Sort [ @a first , @a last ) in parallel.
+ *
+ * @param first First element.
+ * @param last One past the last element.
+ * @param cmp Comparison.
+ *
+ * This is a parallel quicksort which falls back to @c std::sort for small ranges. It is not
+ * stable.
+ */
+template <typename I, typename C>
+void
+parallel_sort(I first, I last, C cmp)
+{
+  static constexpr ptrdiff_t SEQUENTIAL_SIZE = 4096; ///< Ranges this size or smaller are not split.
+
+  if (last - first <= SEQUENTIAL_SIZE || WorkPool::instance().size() == 0) {
+    std::sort(first, last, cmp);
+    return;
+  }
+  // Median of three pivot, copied because the partition moves elements.
+  auto mid = first + (last - first) / 2;
+  typename std::iterator_traits<I>::value_type pivot =
+    std::max(std::min(*first, *mid, cmp), std::min(std::max(*first, *mid, cmp), *(last - 1), cmp), cmp);
+  // Three way partition, so that ranges with many equal elements still shrink.
+  auto lt = std::partition(first, last, [&](auto const &x) { return cmp(x, pivot); });
+  auto gt = std::partition(lt, last, [&](auto const &x) { return !cmp(pivot, x); });
+  parallel_invoke([&]() { parallel_sort(first, lt, cmp); }, [&]() { parallel_sort(gt, last, cmp); });
+}
+
+/// Sort [ @a first , @a last ) in parallel using @c operator<.
+template <typename I>
+void
+parallel_sort(I first, I last)
+{
+  parallel_sort(first, last, std::less<>());
+}
+
+} // namespace ts
@@ -12,6 +12,7 @@
 #include <shared_mutex>
 
 #include "ts_util.h"
+#include "ts_work.h"
 #include <swoc/TextView.h>
 #include <swoc/Errata.h>
 #include <swoc/BufferWriter.h>
@@ -122,7 +123,7 @@ Config::load(swoc::file::path const& file) {
       _data.push_back(n);
     }
   }
-  std::sort(_data.begin(), _data.end(), std::less<decltype(_data)::value_type>());
+  ts::parallel_sort(_data.begin(), _data.end(), std::less<decltype(_data)::value_type>());
   return {};
 }
 
@@ -150,6 +151,7 @@ Init(MemSpan<char const*> argv)
   TSDebug(Config::PLUGIN_NAME.data(), "Configuration loaded");
 
   static constexpr TextView KEY_PATH    = "path";
+  static constexpr TextView KEY_THREADS = "threads";
 
   for (unsigned idx = 0; idx < argv.count(); ++idx) {
     TextView arg{argv[idx], TextView::npos};
@@ -174,6 +176,15 @@ Init(MemSpan<char const*> argv)
 
       if (arg.starts_with_nocase(KEY_PATH)) {
         path = value;
+      } else if (arg.starts_with_nocase(KEY_THREADS)) {
+        TextView parsed;
+        auto n = swoc::svtou(value, &parsed);
+        if (parsed.size() != value.size()) {
+          return Errata(ts::S_ERROR, "Arg {} option '{}' value '{}' is not a number.", idx, arg, value);
+        }
+        if (!ts::WorkPool::init(n)) {
+          return Errata(ts::S_ERROR, "Arg {} option '{}' - the work pool has already been created.", idx, arg);
+        }
       } else {
         return Errata(ts::S_ERROR, "Arg {} is an unrecognized option '{}'.", idx, arg);
       }
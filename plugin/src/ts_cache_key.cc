@@ -0,0 +1,280 @@
+/** @file
+   Compiled cache key templates.
+
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+*/
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <tuple>
+
+#include <swoc/TextView.h>
+#include <swoc/Errata.h>
+#include <swoc/bwf_base.h>
+
+#include "ts_cache_key.h"
+
+using swoc::TextView;
+using swoc::Errata;
+using swoc::Rv;
+using swoc::BufferWriter;
+using swoc::MemSpan;
+using namespace swoc::literals;
+
+/* ------------------------------------------------------------------------------------ */
+namespace ts
+{
+namespace swoc = ::swoc; // Import to avoid global naming weirdness.
+/* ------------------------------------------------------------------------------------ */
+
+TextView
+CacheKeyTemplate::localize(TextView const &text)
+{
+  auto span = _arena.alloc(text.size()).rebind<char>();
+  memcpy(span.data(), text.data(), text.size());
+  return {span.data(), span.count()};
+}
+
+Errata
+CacheKeyTemplate::parse_extractor(TextView spec)
+{
+  static constexpr TextView SCHEME = "scheme";
+  static constexpr TextView HOST   = "host";
+  static constexpr TextView PORT   = "port";
+  static constexpr TextView METHOD = "method";
+  static constexpr TextView PATH   = "path";
+  static constexpr TextView QUERY  = "query";
+  static constexpr TextView FIELD  = "hdr";
+  static constexpr TextView SORTED = "sorted";
+  static constexpr TextView ALLOW  = "allow";
+  static constexpr TextView DENY   = "deny";
+
+  Op op;
+  auto name = spec.take_prefix_at(':').trim_if(&isspace);
+  if (0 == strcasecmp(name, SCHEME)) {
+    op._type = OpType::SCHEME;
+  } else if (0 == strcasecmp(name, HOST)) {
+    op._type = OpType::HOST;
+  } else if (0 == strcasecmp(name, PORT)) {
+    op._type = OpType::PORT;
+  } else if (0 == strcasecmp(name, METHOD)) {
+    op._type = OpType::METHOD;
+  } else if (0 == strcasecmp(name, PATH)) {
+    op._type = OpType::PATH;
+  } else if (0 == strcasecmp(name, FIELD)) {
+    spec.trim_if(&isspace);
+    if (spec.empty()) {
+      return Errata(S_ERROR, R"(Cache key extractor "{}" requires a field name.)", FIELD);
+    }
+    op._type = OpType::FIELD;
+    op._text = this->localize(spec);
+    spec.clear();
+  } else if (0 == strcasecmp(name, QUERY)) {
+    op._type = OpType::QUERY;
+    while (spec) {
+      auto opt = spec.take_prefix_at(':').trim_if(&isspace);
+      auto key = opt.take_prefix_at('=');
+      if (0 == strcasecmp(key, SORTED)) {
+        op._sorted_p = true;
+      } else if (0 == strcasecmp(key, ALLOW) || 0 == strcasecmp(key, DENY)) {
+        if (op._filter_p) {
+          return Errata(S_ERROR, R"(Cache key extractor "{}" may have only one of "{}" or "{}".)", QUERY, ALLOW, DENY);
+        }
+        op._filter_p = true;
+        op._deny_p   = 0 == strcasecmp(key, DENY);
+        auto n     = std::count(opt.begin(), opt.end(), ',') + 1;
+        op._names  = _arena.alloc(n * sizeof(TextView)).rebind<TextView>();
+        n          = 0;
+        while (opt) {
+          if (auto elt = opt.take_prefix_at(',').trim_if(&isspace); !elt.empty()) {
+            op._names[n++] = this->localize(elt);
+          }
+        }
+        if (n == 0) {
+          return Errata(S_ERROR, R"(Cache key extractor "{}" option "{}" requires at least one name.)", QUERY, key);
+        }
+        op._names = op._names.prefix(n);
+      } else {
+        return Errata(S_ERROR, R"(Cache key extractor "{}" has unrecognized option "{}".)", QUERY, key);
+      }
+    }
+  } else {
+    return Errata(S_ERROR, R"(Unrecognized cache key extractor "{}".)", name);
+  }
+
+  if (spec) {
+    return Errata(S_ERROR, R"(Cache key extractor "{}" does not take options.)", name);
+  }
+  _ops.push_back(op);
+  return {};
+}
+
+Rv<CacheKeyTemplate>
+CacheKeyTemplate::compile(TextView fmt)
+{
+  self_type zret;
+  std::string literal; // Accumulated literal text, to coalesce escaped braces.
+
+  auto flush = [&]() -> void {
+    if (!literal.empty()) {
+      Op op;
+      op._text = zret.localize(literal);
+      zret._ops.push_back(op);
+      literal.clear();
+    }
+  };
+
+  while (fmt) {
+    auto spot = std::find_if(fmt.begin(), fmt.end(), [](char c) { return c == '{' || c == '}'; });
+    literal.append(fmt.data(), spot - fmt.begin());
+    if (spot == fmt.end()) { // no brace found, all literal.
+      break;
+    }
+    char brace = *spot;
+    fmt.remove_prefix(spot - fmt.begin() + 1);
+    if (!fmt.empty() && fmt.front() == brace) { // doubled brace is a literal brace.
+      literal.push_back(brace);
+      fmt.remove_prefix(1);
+      continue;
+    }
+    if (brace == '}') {
+      return Errata(S_ERROR, R"(Unmatched '}}' in cache key template after "{}".)", literal);
+    }
+    if (fmt.find('}') == TextView::npos) {
+      return Errata(S_ERROR, R"(Unterminated extractor "{}" in cache key template.)", fmt);
+    }
+    auto spec = fmt.take_prefix_at('}');
+    flush();
+    if (auto errata = zret.parse_extractor(spec); !errata.is_ok()) {
+      return std::move(errata);
+    }
+  }
+  flush();
+  return std::move(zret);
+}
+
+void
+CacheKeyTemplate::write_query(BufferWriter &w, Op const &op, TextView query)
+{
+  using Param = std::tuple<TextView, TextView>;
+
+  auto allowed = [&](TextView const &name) -> bool {
+    if (!op._filter_p) {
+      return true;
+    }
+    bool found = std::any_of(op._names.begin(), op._names.end(), [&](TextView const &n) { return n == name; });
+    return found != op._deny_p;
+  };
+  // The full parameter text, including the '=' and value if present.
+  auto param_text = [](Param const &p) -> TextView { return {std::get<0>(p).data(), std::get<1>(p).data_end()}; };
+
+  if (!op._sorted_p) {
+    bool first_p = true;
+    while (query) {
+      auto param = take_query_pair(query);
+      if (std::get<0>(param).empty() || !allowed(std::get<0>(param))) {
+        continue;
+      }
+      if (!first_p) {
+        w.write('&');
+      }
+      first_p = false;
+      w.write(param_text(param));
+    }
+    return;
+  }
+
+  // Sorting - collect the parameters on the stack, unless there are an absurd number of them.
+  std::array<Param, MAX_SORTED_PARAMS> local;
+  std::vector<Param> overflow;
+  size_t n = 0;
+  while (query) {
+    auto param = take_query_pair(query);
+    if (std::get<0>(param).empty() || !allowed(std::get<0>(param))) {
+      continue;
+    }
+    if (n < local.size()) {
+      local[n++] = param;
+    } else {
+      if (overflow.empty()) {
+        overflow.assign(local.begin(), local.end());
+      }
+      overflow.push_back(param);
+    }
+  }
+
+  MemSpan<Param> params = overflow.empty() ? MemSpan<Param>{local.data(), n} : MemSpan<Param>{overflow.data(), overflow.size()};
+  std::stable_sort(params.begin(), params.end(), [](Param const &lhs, Param const &rhs) { return std::get<0>(lhs) < std::get<0>(rhs); });
+  bool first_p = true;
+  for (auto const &param : params) {
+    if (!first_p) {
+      w.write('&');
+    }
+    first_p = false;
+    w.write(param_text(param));
+  }
+}
+
+BufferWriter &
+CacheKeyTemplate::write(BufferWriter &w, HttpTxn &txn) const
+{
+  auto req{txn.ua_req_hdr()};
+  if (!req.is_valid()) {
+    return w;
+  }
+  auto url{req.url()};
+
+  for (auto const &op : _ops) {
+    switch (op._type) {
+    case OpType::LITERAL:
+      w.write(op._text);
+      break;
+    case OpType::SCHEME:
+      w.write(url.scheme());
+      break;
+    case OpType::HOST:
+      w.write(req.host());
+      break;
+    case OpType::PORT:
+      bwformat(w, swoc::bwf::Spec::DEFAULT, req.port());
+      break;
+    case OpType::METHOD:
+      w.write(req.method());
+      break;
+    case OpType::PATH:
+      w.write(url.path());
+      break;
+    case OpType::QUERY:
+      write_query(w, op, url.query());
+      break;
+    case OpType::FIELD:
+      if (auto field{req.field(op._text)}; field.is_valid()) {
+        w.write(field.value());
+      }
+      break;
+    }
+  }
+  return w;
+}
+
+Status
+CacheKeyTemplate::assign(HttpTxn &txn) const
+{
+  swoc::LocalBufferWriter<4096> w;
+  this->write(w, txn);
+  if (!w.error()) {
+    return txn.cache_key_set(w.view());
+  }
+  // Do it the hard way.
+  ScratchArena scratch;
+  auto buff = scratch.alloc(w.extent());
+  swoc::FixedBufferWriter fw(buff.data(), buff.size());
+  this->write(fw, txn);
+  return txn.cache_key_set(fw.view());
+}
+
+/* ------------------------------------------------------------------------------------ */
+} // namespace ts
+/* ------------------------------------------------------------------------------------ */
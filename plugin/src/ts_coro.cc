@@ -0,0 +1,117 @@
+/** @file
+   Coroutine adapters for TS continuations.
+
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+*/
+
+#include "ts_coro.h"
+
+#if TS_UTIL_HAS_COROUTINES
+
+#include <array>
+#include <new>
+
+/* ------------------------------------------------------------------------------------ */
+namespace ts
+{
+/* ------------------------------------------------------------------------------------ */
+namespace
+{
+  /// Free frames for a thread.
+  struct FramePool {
+    /// Free list element, overlaid on the frame.
+    struct Frame {
+      Frame *_next;
+    };
+
+    std::array<Frame *, CoroFramePool::N_CLASSES> _head{}; ///< Free lists by class.
+    std::array<size_t, CoroFramePool::N_CLASSES> _count{}; ///< Number of frames in each free list.
+
+    ~FramePool()
+    {
+      for (auto &head : _head) {
+        while (head) {
+          ::operator delete(std::exchange(head, head->_next));
+        }
+      }
+    }
+  };
+
+  thread_local FramePool Frame_Pool;
+
+  /// @return The size class for @a n bytes.
+  inline size_t
+  size_class(size_t n)
+  {
+    return (n + CoroFramePool::CLASS_SIZE - 1) / CoroFramePool::CLASS_SIZE - 1;
+  }
+} // namespace
+
+void *
+CoroFramePool::alloc(size_t n)
+{
+  auto idx = size_class(n);
+  if (idx >= N_CLASSES) {
+    return ::operator new(n);
+  }
+  if (auto &head = Frame_Pool._head[idx]; head != nullptr) {
+    --Frame_Pool._count[idx];
+    return std::exchange(head, head->_next);
+  }
+  return ::operator new((idx + 1) * CLASS_SIZE);
+}
+
+void
+CoroFramePool::free(void *ptr, size_t n)
+{
+  auto idx = size_class(n);
+  if (idx >= N_CLASSES || Frame_Pool._count[idx] >= MAX_POOLED) {
+    ::operator delete(ptr);
+    return;
+  }
+  auto frame            = static_cast<FramePool::Frame *>(ptr);
+  frame->_next          = Frame_Pool._head[idx];
+  Frame_Pool._head[idx] = frame;
+  ++Frame_Pool._count[idx];
+}
+
+void
+WaitForHook::await_suspend(std::coroutine_handle<> h)
+{
+  _handle   = h;
+  auto cont = TSContCreate(&WaitForHook::on_hook, nullptr);
+  TSContDataSet(cont, this);
+  TSHttpTxnHookAdd(_txn, _hook, cont);
+  if (_hook != TS_HTTP_TXN_CLOSE_HOOK) {
+    TSHttpTxnHookAdd(_txn, TS_HTTP_TXN_CLOSE_HOOK, cont);
+  }
+}
+
+int
+WaitForHook::on_hook(TSCont contp, TSEvent event, void *edata)
+{
+  auto self = static_cast<WaitForHook *>(TSContDataGet(contp));
+  if (event != TS_EVENT_HTTP_TXN_CLOSE) { // awaited hook, the coroutine reenables.
+    TSContDataSet(contp, nullptr);
+    self->_event = event;
+    self->_handle.resume(); // @a self may be gone after this.
+    return 0;
+  }
+
+  // Transaction close, the coroutine never reenables this - even if it is the awaited hook.
+  auto txn = static_cast<TSHttpTxn>(edata);
+  TSContDestroy(contp);
+  if (self) {
+    self->_event = event;
+    self->_handle.resume();
+  }
+  TSHttpTxnReenable(txn, TS_EVENT_HTTP_CONTINUE);
+  return 0;
+}
+
+/* ------------------------------------------------------------------------------------ */
+} // namespace ts
+/* ------------------------------------------------------------------------------------ */
+
+#endif
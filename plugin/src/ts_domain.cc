@@ -0,0 +1,162 @@
+/** @file
+   Domain matching for host and SNI allow lists.
+
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+*/
+
+#include <algorithm>
+#include <cctype>
+
+#include "ts_domain.h"
+
+using swoc::TextView;
+using swoc::Errata;
+
+/* ------------------------------------------------------------------------------------ */
+namespace ts
+{
+/* ------------------------------------------------------------------------------------ */
+namespace
+{
+  inline unsigned char
+  lower(char c)
+  {
+    return tolower(static_cast<unsigned char>(c));
+  }
+
+  /// Compare a stored (lower case) label @a lhs to @a rhs, ignoring case of @a rhs.
+  int
+  label_cmp(TextView const &lhs, TextView const &rhs)
+  {
+    auto n = std::min(lhs.size(), rhs.size());
+    for (size_t i = 0; i < n; ++i) {
+      if (auto l = static_cast<unsigned char>(lhs[i]), r = lower(rhs[i]); l != r) {
+        return l < r ? -1 : 1;
+      }
+    }
+    return lhs.size() < rhs.size() ? -1 : lhs.size() > rhs.size() ? 1 : 0;
+  }
+} // namespace
+
+Errata
+DomainMatcher::add(TextView domain)
+{
+  domain.trim_if(&isspace).rtrim('.');
+  auto src{domain};
+
+  Entry entry;
+  entry._flags = EXACT;
+  if (domain.size() > 1 && domain[0] == '*' && domain[1] == '.') {
+    entry._flags = WILDCARD;
+    domain.remove_prefix(2);
+  }
+  if (domain.empty() || domain.find('*') != TextView::npos) {
+    return Errata(S_ERROR, R"(Domain "{}" is invalid - a wildcard must be a leading "*.".)", src);
+  }
+
+  auto span = _arena.alloc(domain.size()).rebind<char>();
+  std::transform(domain.begin(), domain.end(), span.begin(), &lower);
+  TextView text{span.data(), span.count()};
+  while (text) {
+    auto label = text.take_suffix_at('.');
+    if (label.empty() || label.size() > MAX_LABEL) {
+      return Errata(S_ERROR, R"(Domain "{}" has an invalid label.)", src);
+    }
+    entry._labels.push_back(label);
+  }
+  _pending.emplace_back(std::move(entry));
+  return {};
+}
+
+auto
+DomainMatcher::compile() -> self_type &
+{
+  std::sort(_pending.begin(), _pending.end(), [](Entry const &lhs, Entry const &rhs) {
+    return std::lexicographical_compare(lhs._labels.begin(), lhs._labels.end(), rhs._labels.begin(), rhs._labels.end());
+  });
+
+  _nodes.clear();
+  _labels.clear();
+  _nodes.emplace_back();
+  this->build(0, _pending.data(), _pending.data() + _pending.size(), 0);
+  _nodes.shrink_to_fit();
+  _labels.shrink_to_fit();
+  _count = _pending.size();
+
+  // Loading data is no longer needed.
+  decltype(_pending)().swap(_pending);
+  _arena.clear();
+  return *this;
+}
+
+void
+DomainMatcher::build(uint32_t idx, Entry *begin, Entry *end, size_t depth)
+{
+  // Sorted, so entries that end at this node are first. There can be more than one if a domain is
+  // added more than once, or as both exact and wildcard.
+  for (; begin < end && begin->_labels.size() == depth; ++begin) {
+    _nodes[idx]._flags |= begin->_flags;
+  }
+  if (begin == end) {
+    return;
+  }
+
+  // Count the distinct labels - each is a child. Children are contiguous so they are allocated
+  // before any descendants.
+  uint32_t n = 0;
+  for (auto spot = begin; spot < end; ++n) {
+    auto label = spot->_labels[depth];
+    spot       = std::find_if(spot, end, [=](Entry const &e) { return e._labels[depth] != label; });
+  }
+  uint32_t child       = _nodes.size();
+  _nodes[idx]._child   = child;
+  _nodes[idx]._n_child = n;
+  _nodes.resize(_nodes.size() + n);
+
+  for (auto spot = begin; spot < end; ++child) {
+    auto label  = spot->_labels[depth];
+    auto limit  = std::find_if(spot, end, [=](Entry const &e) { return e._labels[depth] != label; });
+    auto &node  = _nodes[child];
+    node._text  = _labels.size();
+    node._len   = label.size();
+    _labels.append(label.data(), label.size());
+    this->build(child, spot, limit, depth + 1);
+    spot = limit;
+  }
+}
+
+bool
+DomainMatcher::contains(TextView name) const
+{
+  name.rtrim('.');
+  if (name.empty() || _nodes.empty()) {
+    return false;
+  }
+
+  Node const *node = &_nodes[0];
+  while (name) {
+    auto label = name.take_suffix_at('.');
+    if (label.empty() || label.size() > MAX_LABEL || node->_n_child == 0) {
+      return false;
+    }
+    auto first = _nodes.data() + node->_child;
+    auto last  = first + node->_n_child;
+    auto spot  = std::lower_bound(first, last, label, [&](Node const &n, TextView const &l) { return label_cmp(this->label(n), l) < 0; });
+    if (spot == last || label_cmp(this->label(*spot), label) != 0) {
+      return false;
+    }
+    node = spot;
+    if (name.empty()) {
+      return node->_flags & EXACT;
+    }
+    if (node->_flags & WILDCARD) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* ------------------------------------------------------------------------------------ */
+} // namespace ts
+/* ------------------------------------------------------------------------------------ */
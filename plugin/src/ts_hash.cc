@@ -0,0 +1,203 @@
+/** @file
+   Streaming hashes for URLs and request targets.
+
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+*/
+
+#include <algorithm>
+#include <cctype>
+
+#include "ts_hash.h"
+
+using swoc::TextView;
+
+/* ------------------------------------------------------------------------------------ */
+namespace ts
+{
+/* ------------------------------------------------------------------------------------ */
+namespace
+{
+  constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+  constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+  constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+  /// Seed adjustment for the high lane of @c Hash128.
+  constexpr uint64_t HI_LANE_SEED = 0x9FB21C651E98DF25ULL;
+
+  inline uint64_t
+  rotl(uint64_t x, int r)
+  {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  // Unaligned little endian loads - memcpy is compiled to a single load.
+  inline uint64_t
+  read64(uint8_t const *p)
+  {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+  }
+
+  inline uint32_t
+  read32(uint8_t const *p)
+  {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+  }
+
+  inline uint64_t
+  round(uint64_t acc, uint64_t input)
+  {
+    acc += input * PRIME64_2;
+    acc = rotl(acc, 31);
+    return acc * PRIME64_1;
+  }
+
+  inline uint64_t
+  merge_round(uint64_t acc, uint64_t val)
+  {
+    acc ^= round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+  }
+
+  inline void
+  consume_stripe(std::array<uint64_t, 4> &v, uint8_t const *p)
+  {
+    v[0] = round(v[0], read64(p));
+    v[1] = round(v[1], read64(p + 8));
+    v[2] = round(v[2], read64(p + 16));
+    v[3] = round(v[3], read64(p + 24));
+  }
+
+  /// Feed @a text to @a h in lower case, in chunks, without allocating.
+  template <typename H>
+  void
+  feed_nocase(H &h, TextView text)
+  {
+    char buff[64];
+    while (text) {
+      auto chunk = text.prefix(sizeof(buff));
+      text.remove_prefix(chunk.size());
+      std::transform(chunk.begin(), chunk.end(), buff, [](char c) { return char(tolower(static_cast<unsigned char>(c))); });
+      h.update(buff, chunk.size());
+    }
+  }
+} // namespace
+
+Hash64::Hash64(uint64_t seed) : _v{{seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1}}, _seed(seed) {}
+
+auto
+Hash64::update(void const *data, size_t n) -> self_type &
+{
+  auto p     = static_cast<uint8_t const *>(data);
+  auto limit = p + n;
+  _total += n;
+
+  if (_buff_n) { // finish a partial stripe first.
+    size_t k = std::min(n, STRIPE - _buff_n);
+    memcpy(_buff.data() + _buff_n, p, k);
+    _buff_n += k;
+    p += k;
+    if (_buff_n < STRIPE) {
+      return *this;
+    }
+    consume_stripe(_v, _buff.data());
+    _buff_n = 0;
+  }
+
+  while (limit - p >= static_cast<ptrdiff_t>(STRIPE)) {
+    consume_stripe(_v, p);
+    p += STRIPE;
+  }
+
+  if (p < limit) {
+    _buff_n = limit - p;
+    memcpy(_buff.data(), p, _buff_n);
+  }
+  return *this;
+}
+
+auto
+Hash64::update_nocase(TextView text) -> self_type &
+{
+  feed_nocase(*this, text);
+  return *this;
+}
+
+auto
+Hash64::final() const -> value_type
+{
+  uint64_t h;
+  if (_total >= STRIPE) {
+    h = rotl(_v[0], 1) + rotl(_v[1], 7) + rotl(_v[2], 12) + rotl(_v[3], 18);
+    for (auto v : _v) {
+      h = merge_round(h, v);
+    }
+  } else {
+    h = _seed + PRIME64_5;
+  }
+  h += _total;
+
+  auto p     = _buff.data();
+  auto limit = p + _buff_n;
+  for (; limit - p >= 8; p += 8) {
+    h ^= round(0, read64(p));
+    h = rotl(h, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (limit - p >= 4) {
+    h ^= uint64_t(read32(p)) * PRIME64_1;
+    h = rotl(h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+  for (; p < limit; ++p) {
+    h ^= *p * PRIME64_5;
+    h = rotl(h, 11) * PRIME64_1;
+  }
+
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+/* ------------------------------------------------------------------------------------ */
+
+Hash128::Hash128(uint64_t seed) : _lo(seed), _hi(seed ^ HI_LANE_SEED) {}
+
+auto
+Hash128::update(void const *data, size_t n) -> self_type &
+{
+  _lo.update(data, n);
+  _hi.update(data, n);
+  return *this;
+}
+
+auto
+Hash128::update_nocase(TextView text) -> self_type &
+{
+  feed_nocase(*this, text);
+  return *this;
+}
+
+auto
+Hash128::final() const -> value_type
+{
+  return {_lo.final(), _hi.final()};
+}
+
+/* ------------------------------------------------------------------------------------ */
+} // namespace ts
+/* ------------------------------------------------------------------------------------ */
@@ -0,0 +1,223 @@
+/** @file
+   Percent encoding and decoding.
+
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+*/
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TS_PCT_X86 1
+#endif
+
+#include "ts_percent.h"
+
+using swoc::TextView;
+using swoc::BufferWriter;
+
+/* ------------------------------------------------------------------------------------ */
+namespace ts
+{
+/* ------------------------------------------------------------------------------------ */
+namespace
+{
+  /** Character set tables.
+   *
+   * @a _safe is the plain lookup table. @a _nibble is the same set in a form for vector lookup -
+   * bit @c h of entry @c l is set if the character @c (h << 4 | l) is in the set. Only ASCII
+   * characters can be in a set, so the high nibble is at most 7.
+   */
+  struct CharSet {
+    std::array<bool, 256> _safe{};
+    alignas(16) std::array<uint8_t, 16> _nibble{};
+
+    constexpr CharSet(char const *extra)
+    {
+      for (unsigned c = 0; c < 256; ++c) {
+        _safe[c] = ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '-' || c == '.' ||
+                   c == '_' || c == '~';
+      }
+      for (; *extra; ++extra) {
+        _safe[static_cast<unsigned char>(*extra)] = true;
+      }
+      for (unsigned c = 0; c < 128; ++c) {
+        if (_safe[c]) {
+          _nibble[c & 0xF] |= 1 << (c >> 4);
+        }
+      }
+    }
+  };
+
+  constexpr CharSet UNRESERVED_SET{""};
+  constexpr CharSet PATH_SET{"!$&'()*+,;=:@/"};
+  constexpr CharSet QUERY_SET{"!$'()*,:@/?"};
+
+  inline CharSet const &
+  char_set(PctSet set)
+  {
+    switch (set) {
+    case PctSet::PATH:
+      return PATH_SET;
+    case PctSet::QUERY:
+      return QUERY_SET;
+    default:
+      break;
+    }
+    return UNRESERVED_SET;
+  }
+
+  constexpr char HEX_DIGIT[] = "0123456789ABCDEF";
+
+  inline int
+  hex_value(char c)
+  {
+    if ('0' <= c && c <= '9') {
+      return c - '0';
+    } else if ('a' <= c && c <= 'f') {
+      return c - 'a' + 10;
+    } else if ('A' <= c && c <= 'F') {
+      return c - 'A' + 10;
+    }
+    return -1;
+  }
+
+  /// @return The number of leading characters of @a text in @a set.
+  size_t
+  safe_prefix_scalar(TextView const &text, CharSet const &set, size_t idx)
+  {
+    auto n = text.size();
+    while (idx < n && set._safe[static_cast<unsigned char>(text[idx])]) {
+      ++idx;
+    }
+    return idx;
+  }
+
+#if TS_PCT_X86
+  // Use SSSE3 if the CPU has it, even if the compiler target does not assume it.
+  __attribute__((target("ssse3"))) size_t
+  safe_prefix_ssse3(TextView const &text, CharSet const &set)
+  {
+    // Nibble lookup - a character is safe if the bit for its high nibble is set in the table entry
+    // for its low nibble.
+    __m128i const nibble_tbl = _mm_load_si128(reinterpret_cast<__m128i const *>(set._nibble.data()));
+    __m128i const hi_bit_tbl = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, char(128), 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i const low_mask   = _mm_set1_epi8(0x0F);
+    __m128i const zero       = _mm_setzero_si128();
+
+    size_t idx = 0;
+    auto src   = text.data();
+    for (auto n = text.size(); idx + 16 <= n; idx += 16) {
+      __m128i v    = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + idx));
+      __m128i lo   = _mm_and_si128(v, low_mask);
+      __m128i hi   = _mm_and_si128(_mm_srli_epi16(v, 4), low_mask);
+      __m128i bits = _mm_and_si128(_mm_shuffle_epi8(nibble_tbl, lo), _mm_shuffle_epi8(hi_bit_tbl, hi));
+      if (int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bits, zero)); mask != 0) {
+        return idx + __builtin_ctz(mask);
+      }
+    }
+    return safe_prefix_scalar(text, set, idx);
+  }
+
+  bool const HAVE_SSSE3 = []() -> bool {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+  }();
+#endif
+
+  inline size_t
+  safe_prefix(TextView const &text, CharSet const &set)
+  {
+#if TS_PCT_X86
+    if (HAVE_SSSE3 && text.size() >= 16) {
+      return safe_prefix_ssse3(text, set);
+    }
+#endif
+    return safe_prefix_scalar(text, set, 0);
+  }
+
+  /// @return The index of the first '%', or '+' if @a plus_p, or the size of @a text if none.
+  inline size_t
+  escape_offset(TextView const &text, bool plus_p)
+  {
+    size_t idx = 0;
+    auto n     = text.size();
+    auto src   = text.data();
+#if defined(__SSE2__)
+    __m128i const pct  = _mm_set1_epi8('%');
+    __m128i const plus = _mm_set1_epi8(plus_p ? '+' : '%');
+    for (; idx + 16 <= n; idx += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + idx));
+      if (int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, pct), _mm_cmpeq_epi8(v, plus))); mask != 0) {
+        return idx + __builtin_ctz(mask);
+      }
+    }
+#endif
+    while (idx < n && src[idx] != '%' && !(plus_p && src[idx] == '+')) {
+      ++idx;
+    }
+    return idx;
+  }
+} // namespace
+
+bool
+pct_needs_encoding(TextView text, PctSet set)
+{
+  return safe_prefix(text, char_set(set)) < text.size();
+}
+
+BufferWriter &
+pct_encode(BufferWriter &w, TextView text, PctSet set)
+{
+  auto const &cs = char_set(set);
+  while (text) {
+    auto n = safe_prefix(text, cs);
+    w.write(text.data(), n);
+    text.remove_prefix(n);
+    // Escape characters until the next safe one.
+    while (text && !cs._safe[static_cast<unsigned char>(text[0])]) {
+      auto c = static_cast<unsigned char>(text[0]);
+      w.write('%');
+      w.write(HEX_DIGIT[c >> 4]);
+      w.write(HEX_DIGIT[c & 0xF]);
+      text.remove_prefix(1);
+    }
+  }
+  return w;
+}
+
+bool
+pct_needs_decoding(TextView text, bool plus_p)
+{
+  return escape_offset(text, plus_p) < text.size();
+}
+
+BufferWriter &
+pct_decode(BufferWriter &w, TextView text, bool plus_p)
+{
+  while (text) {
+    auto n = escape_offset(text, plus_p);
+    w.write(text.data(), n);
+    text.remove_prefix(n);
+    if (text.empty()) {
+      break;
+    }
+    if (text[0] == '+') {
+      w.write(' ');
+      text.remove_prefix(1);
+    } else if (int hi, lo; text.size() >= 3 && (hi = hex_value(text[1])) >= 0 && (lo = hex_value(text[2])) >= 0) {
+      w.write(char(hi << 4 | lo));
+      text.remove_prefix(3);
+    } else { // Invalid escape, pass it through.
+      w.write('%');
+      text.remove_prefix(1);
+    }
+  }
+  return w;
+}
+
+/* ------------------------------------------------------------------------------------ */
+} // namespace ts
+/* ------------------------------------------------------------------------------------ */
@@ -0,0 +1,180 @@
+/** @file
+   Hashed hierarchical timing wheel.
+
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+*/
+
+#include <algorithm>
+
+#include "ts_timer.h"
+
+/* ------------------------------------------------------------------------------------ */
+namespace ts
+{
+/* ------------------------------------------------------------------------------------ */
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution, ExpireFn &&f)
+  : _resolution(std::max(resolution, std::chrono::milliseconds{1})), _expire_fn(std::move(f))
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+  this->stop();
+}
+
+void
+TimerWheel::start()
+{
+  this->stop();
+  _epoch        = std::chrono::steady_clock::now() - _now * _resolution;
+  _gate         = std::make_shared<Gate>();
+  _gate->_wheel = this;
+  _task         = PerformAsTaskEvery(
+    [gate = _gate]() {
+      std::lock_guard lock(gate->_lock);
+      if (gate->_wheel) {
+        gate->_wheel->tick();
+      }
+    },
+    _resolution);
+}
+
+void
+TimerWheel::stop()
+{
+  if (_gate) {
+    // Canceling does not wait for a tick that is running, but clearing the wheel under the gate
+    // lock does, and prevents any later tick from touching the wheel.
+    {
+      std::lock_guard lock(_gate->_lock);
+      _gate->_wheel = nullptr;
+    }
+    _gate.reset();
+  }
+  _task.cancel();
+}
+
+void
+TimerWheel::link(Timer *timer)
+{
+  // Timers already due go in the current slot, to expire on the next tick.
+  uint64_t expire = std::max(timer->_expire, _now);
+  uint64_t delta  = expire - _now;
+  unsigned level  = 0;
+  while (level < N_LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+    ++level;
+  }
+  if (delta >= (uint64_t(1) << (SLOT_BITS * N_LEVELS))) { // clamp to the longest delay.
+    expire         = _now + (uint64_t(1) << (SLOT_BITS * N_LEVELS)) - 1;
+    timer->_expire = expire;
+  }
+  auto &head = _slots[level][(expire >> (SLOT_BITS * level)) & (N_SLOTS - 1)];
+  timer->_next = head;
+  if (head) {
+    head->_pprev = &timer->_next;
+  }
+  head          = timer;
+  timer->_pprev = &head;
+}
+
+void
+TimerWheel::unlink(Timer *timer)
+{
+  *timer->_pprev = timer->_next;
+  if (timer->_next) {
+    timer->_next->_pprev = timer->_pprev;
+  }
+  timer->_next  = nullptr;
+  timer->_pprev = nullptr;
+}
+
+void
+TimerWheel::schedule(Timer &timer, std::chrono::milliseconds delay)
+{
+  // Round up, so a timer never expires early.
+  uint64_t ticks = (std::max<int64_t>(delay.count(), 0) + _resolution.count() - 1) / _resolution.count();
+  std::lock_guard lock(_lock);
+  if (timer.is_active()) {
+    unlink(&timer);
+  } else {
+    ++_count;
+  }
+  timer._expire = _now + ticks;
+  this->link(&timer);
+}
+
+bool
+TimerWheel::cancel(Timer &timer)
+{
+  std::lock_guard lock(_lock);
+  if (!timer.is_active()) {
+    return false;
+  }
+  unlink(&timer);
+  --_count;
+  return true;
+}
+
+size_t
+TimerWheel::count() const
+{
+  std::lock_guard lock(_lock);
+  return _count;
+}
+
+void
+TimerWheel::cascade(unsigned level)
+{
+  auto &head = _slots[level][(_now >> (SLOT_BITS * level)) & (N_SLOTS - 1)];
+  auto timer = head;
+  head       = nullptr;
+  while (timer) {
+    auto next     = timer->_next;
+    timer->_pprev = nullptr;
+    this->link(timer);
+    timer = next;
+  }
+}
+
+void
+TimerWheel::advance(uint64_t n)
+{
+  {
+    std::lock_guard lock(_lock);
+    for (; n > 0; --n) {
+      // When a level wraps, pull down the timers from the next level's current slot.
+      for (unsigned level = 1; level < N_LEVELS && ((_now >> (SLOT_BITS * (level - 1))) & (N_SLOTS - 1)) == 0; ++level) {
+        this->cascade(level);
+      }
+      auto &head = _slots[0][_now & (N_SLOTS - 1)];
+      while (head) {
+        auto timer = head;
+        unlink(timer);
+        _expired.push_back(timer);
+      }
+      ++_now;
+    }
+    _count -= _expired.size();
+  }
+
+  // Expiry callbacks are done without the lock, so they can schedule timers.
+  for (size_t idx = 0; idx < _expired.size(); idx += MAX_BATCH) {
+    _expire_fn(Batch{_expired.data() + idx, std::min(MAX_BATCH, _expired.size() - idx)});
+  }
+  _expired.clear();
+}
+
+void
+TimerWheel::tick()
+{
+  uint64_t target = (std::chrono::steady_clock::now() - _epoch) / _resolution;
+  if (target > _now) { // _now is only changed by this thread, no lock needed to read it.
+    this->advance(target - _now);
+  }
+}
+
+/* ------------------------------------------------------------------------------------ */
+} // namespace ts
+/* ------------------------------------------------------------------------------------ */
@@ -5,10 +5,12 @@
  * SPDX-License-Identifier: Apache-2.0
 */
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <map>
 #include <numeric>
-#include <alloca.h>
+#include <random>
 
 #include <openssl/ssl.h>
 
@@ -45,9 +47,19 @@ const swoc::Lexicon<TSRecordDataType> TSRecordDataTypeNames{{{TS_RECORDDATATYPE_
                                                             TS_RECORDDATATYPE_NULL,
                                                             "null"};
 
-HttpTxn::TxnConfigVarTable ts::HttpTxn::_var_table;
+std::atomic<HttpTxn::TxnConfigVarTable const *> ts::HttpTxn::_var_table{nullptr};
 std::mutex HttpTxn::_var_table_lock;
-int HttpTxn::_arg_idx = -1;
+std::vector<std::unique_ptr<TxnConfigVar>> HttpTxn::_var_store;
+std::vector<std::unique_ptr<HttpTxn::TxnConfigVarTable const>> HttpTxn::_var_table_retired;
+std::array<TxnConfigVar *, TS_CONFIG_LAST_ENTRY> HttpTxn::_var_by_key{};
+std::vector<TxnConfigVar *> HttpTxn::_var_phash;
+uint64_t HttpTxn::_var_phash_seed = 0;
+std::once_flag HttpTxn::_var_preload_flag;
+std::atomic<int> HttpTxn::_arg_idx{-1};
+std::atomic<unsigned> HttpTxn::_slot_count{0};
+std::atomic<int> HttpSsn::_arg_idx{-1};
+std::atomic<unsigned> HttpSsn::_slot_count{0};
+unsigned HttpSsn::_cache_slot = 0;
 
 static std::array<swoc::TextView, 6> S_NAMES = { "Diag", "Debug", "Status", "Note", "Warning", "Error"};
 
@@ -109,6 +121,23 @@ namespace compat
     return TSVConnSslConnectionGet(eraser<V>(vc));
   }
 
+  // ---
+  // ATS 9 added whether the client aborted. Prefer that if available.
+  template <typename T = void>
+  auto
+  txn_aborted(TSHttpTxn txnp, swoc::meta::CaseTag<0>) -> decltype(TSHttpTxnAborted(eraser<T>(txnp)), bool())
+  {
+    return TSHttpTxnAborted(eraser<T>(txnp)) != 0;
+  }
+
+  template <typename T = void>
+  auto
+  txn_aborted(TSHttpTxn txnp, swoc::meta::CaseTag<1>) -> decltype(TSHttpTxnAborted(eraser<T>(txnp), nullptr), bool())
+  {
+    bool client_abort_p = false;
+    return TS_SUCCESS == TSHttpTxnAborted(eraser<T>(txnp), &client_abort_p);
+  }
+
   // ---
   // Txn / Ssn args were changed for ATS 10. Prefer the new API.
 
@@ -179,6 +208,50 @@ namespace compat
     return TSUserArgIndexNameLookup(TS_USER_ARGS_TXN, name, arg_idx, description);
   }
 
+  template <typename A = void>
+  auto
+  ssn_arg_get(TSHttpSsn ssnp, int arg_idx) -> std::enable_if_t<!has_TS_USER_ARGS<A>::value, void *>
+  {
+    return TSHttpSsnArgGet(ssnp, eraser<A>(arg_idx));
+  }
+
+  template <typename A = void>
+  auto
+  ssn_arg_get(TSHttpSsn ssnp, int arg_idx) -> std::enable_if_t<has_TS_USER_ARGS<A>::value, void *>
+  {
+    return TSUserArgGet(ssnp, eraser<A>(arg_idx));
+  }
+
+  template <typename A = void>
+  auto
+  ssn_arg_set(TSHttpSsn ssnp, int arg_idx, void *arg) -> std::enable_if_t<!has_TS_USER_ARGS<A>::value, void>
+  {
+    TSHttpSsnArgSet(ssnp, arg_idx, eraser<A>(arg));
+  }
+
+  template <typename A = void>
+  auto
+  ssn_arg_set(TSHttpSsn ssnp, int arg_idx, void *arg) -> std::enable_if_t<has_TS_USER_ARGS<A>::value, void>
+  {
+    TSUserArgSet(ssnp, arg_idx, eraser<A>(arg));
+  }
+
+  template <typename A = void>
+  auto
+  ssn_arg_index_reserve(const char *name, const char *description, int *arg_idx)
+    -> std::enable_if_t<!has_TS_USER_ARGS<A>::value, TSReturnCode>
+  {
+    return TSHttpSsnArgIndexReserve(name, description, eraser<A>(arg_idx));
+  }
+
+  template <typename A = void>
+  auto
+  ssn_arg_index_reserve(const char *name, const char *description, int *arg_idx)
+    -> std::enable_if_t<has_TS_USER_ARGS<A>::value, TSReturnCode>
+  {
+    return TSUserArgIndexReserve(TS_USER_ARGS_SSN, name, description, eraser<A>(arg_idx));
+  }
+
   // TSHttpTxnServerSsnTransactionCount API only available in ATS 10.
   template <typename T>
   auto
@@ -231,9 +304,171 @@ namespace compat
     TSWarning(diag_fmt, int(text.size()), text.data());
   }
 
+  // ---
+  // ATS 10 can schedule a continuation on every thread of a pool. If that's not available the
+  // result is empty and the caller must use another mechanism.
+  template <typename C = void>
+  auto
+  schedule_on_entire_pool(TSCont, TSThreadPool, swoc::meta::CaseTag<0>) -> std::optional<unsigned>
+  {
+    return std::nullopt;
+  }
+
+  template <typename C = void>
+  auto
+  schedule_on_entire_pool(TSCont cont, TSThreadPool pool, swoc::meta::CaseTag<1>)
+    -> decltype(TSContScheduleOnEntirePool(eraser<C>(cont), 0, pool).size(), std::optional<unsigned>())
+  {
+    return TSContScheduleOnEntirePool(eraser<C>(cont), 0, pool).size();
+  }
+
 } // namespace compat
 
 /* ------------------------------------------------------------------------------------ */
+namespace
+{
+/// Compiled in description of an overridable configuration variable.
+struct TxnConfigVarDef {
+  swoc::TextView _name;
+  TSOverridableConfigKey _key;
+  TSRecordDataType _type;
+};
+
+/// Overridable configuration variables that are preloaded.
+constexpr TxnConfigVarDef TXN_CONFIG_VAR_DEFS[] = {
+  {"proxy.config.url_remap.pristine_host_hdr", TS_CONFIG_URL_REMAP_PRISTINE_HOST_HDR, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.chunking_enabled", TS_CONFIG_HTTP_CHUNKING_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.chunking.size", TS_CONFIG_HTTP_CHUNKING_SIZE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.negative_caching_enabled", TS_CONFIG_HTTP_NEGATIVE_CACHING_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.negative_caching_lifetime", TS_CONFIG_HTTP_NEGATIVE_CACHING_LIFETIME, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.negative_revalidating_enabled", TS_CONFIG_HTTP_NEGATIVE_REVALIDATING_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.negative_revalidating_lifetime", TS_CONFIG_HTTP_NEGATIVE_REVALIDATING_LIFETIME, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.when_to_revalidate", TS_CONFIG_HTTP_CACHE_WHEN_TO_REVALIDATE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.keep_alive_enabled_in", TS_CONFIG_HTTP_KEEP_ALIVE_ENABLED_IN, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.keep_alive_enabled_out", TS_CONFIG_HTTP_KEEP_ALIVE_ENABLED_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.keep_alive_post_out", TS_CONFIG_HTTP_KEEP_ALIVE_POST_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.net.sock_recv_buffer_size_out", TS_CONFIG_NET_SOCK_RECV_BUFFER_SIZE_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.net.sock_send_buffer_size_out", TS_CONFIG_NET_SOCK_SEND_BUFFER_SIZE_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.net.sock_option_flag_out", TS_CONFIG_NET_SOCK_OPTION_FLAG_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.net.sock_packet_mark_out", TS_CONFIG_NET_SOCK_PACKET_MARK_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.net.sock_packet_tos_out", TS_CONFIG_NET_SOCK_PACKET_TOS_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.response_server_enabled", TS_CONFIG_HTTP_RESPONSE_SERVER_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.response_server_str", TS_CONFIG_HTTP_RESPONSE_SERVER_STR, TS_RECORDDATATYPE_STRING},
+  {"proxy.config.http.insert_squid_x_forwarded_for", TS_CONFIG_HTTP_INSERT_SQUID_X_FORWARDED_FOR, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.insert_request_via_str", TS_CONFIG_HTTP_INSERT_REQUEST_VIA_STR, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.insert_response_via_str", TS_CONFIG_HTTP_INSERT_RESPONSE_VIA_STR, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.insert_age_in_response", TS_CONFIG_HTTP_INSERT_AGE_IN_RESPONSE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.global_user_agent_header", TS_CONFIG_HTTP_GLOBAL_USER_AGENT_HEADER, TS_RECORDDATATYPE_STRING},
+  {"proxy.config.http.cache.http", TS_CONFIG_HTTP_CACHE_HTTP, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.generation", TS_CONFIG_HTTP_CACHE_GENERATION, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.ignore_client_no_cache", TS_CONFIG_HTTP_CACHE_IGNORE_CLIENT_NO_CACHE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.ignore_server_no_cache", TS_CONFIG_HTTP_CACHE_IGNORE_SERVER_NO_CACHE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.ignore_authentication", TS_CONFIG_HTTP_CACHE_IGNORE_AUTHENTICATION, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.cache_responses_to_cookies", TS_CONFIG_HTTP_CACHE_CACHE_RESPONSES_TO_COOKIES, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.cache_urls_that_look_dynamic", TS_CONFIG_HTTP_CACHE_CACHE_URLS_THAT_LOOK_DYNAMIC, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.required_headers", TS_CONFIG_HTTP_CACHE_REQUIRED_HEADERS, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.heuristic_min_lifetime", TS_CONFIG_HTTP_CACHE_HEURISTIC_MIN_LIFETIME, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.heuristic_max_lifetime", TS_CONFIG_HTTP_CACHE_HEURISTIC_MAX_LIFETIME, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.heuristic_lm_factor", TS_CONFIG_HTTP_CACHE_HEURISTIC_LM_FACTOR, TS_RECORDDATATYPE_FLOAT},
+  {"proxy.config.http.cache.guaranteed_min_lifetime", TS_CONFIG_HTTP_CACHE_GUARANTEED_MIN_LIFETIME, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.guaranteed_max_lifetime", TS_CONFIG_HTTP_CACHE_GUARANTEED_MAX_LIFETIME, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.max_stale_age", TS_CONFIG_HTTP_CACHE_MAX_STALE_AGE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.range.lookup", TS_CONFIG_HTTP_CACHE_RANGE_LOOKUP, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.range.write", TS_CONFIG_HTTP_CACHE_RANGE_WRITE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.open_read_retry_time", TS_CONFIG_HTTP_CACHE_OPEN_READ_RETRY_TIME, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.max_open_read_retries", TS_CONFIG_HTTP_CACHE_MAX_OPEN_READ_RETRIES, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.max_open_write_retries", TS_CONFIG_HTTP_CACHE_MAX_OPEN_WRITE_RETRIES, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.cache.open_write_fail_action", TS_CONFIG_HTTP_CACHE_OPEN_WRITE_FAIL_ACTION, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.keep_alive_no_activity_timeout_in", TS_CONFIG_HTTP_KEEP_ALIVE_NO_ACTIVITY_TIMEOUT_IN, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.keep_alive_no_activity_timeout_out", TS_CONFIG_HTTP_KEEP_ALIVE_NO_ACTIVITY_TIMEOUT_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.transaction_no_activity_timeout_in", TS_CONFIG_HTTP_TRANSACTION_NO_ACTIVITY_TIMEOUT_IN, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.transaction_no_activity_timeout_out", TS_CONFIG_HTTP_TRANSACTION_NO_ACTIVITY_TIMEOUT_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.transaction_active_timeout_in", TS_CONFIG_HTTP_TRANSACTION_ACTIVE_TIMEOUT_IN, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.transaction_active_timeout_out", TS_CONFIG_HTTP_TRANSACTION_ACTIVE_TIMEOUT_OUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.background_fill_active_timeout", TS_CONFIG_HTTP_BACKGROUND_FILL_ACTIVE_TIMEOUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.background_fill_completed_threshold", TS_CONFIG_HTTP_BACKGROUND_FILL_COMPLETED_THRESHOLD, TS_RECORDDATATYPE_FLOAT},
+  {"proxy.config.http.connect_attempts_max_retries", TS_CONFIG_HTTP_CONNECT_ATTEMPTS_MAX_RETRIES, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.connect_attempts_rr_retries", TS_CONFIG_HTTP_CONNECT_ATTEMPTS_RR_RETRIES, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.connect_attempts_timeout", TS_CONFIG_HTTP_CONNECT_ATTEMPTS_TIMEOUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.doc_in_cache_skip_dns", TS_CONFIG_HTTP_DOC_IN_CACHE_SKIP_DNS, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.flow_control.enabled", TS_CONFIG_HTTP_FLOW_CONTROL_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.flow_control.low_water", TS_CONFIG_HTTP_FLOW_CONTROL_LOW_WATER_MARK, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.flow_control.high_water", TS_CONFIG_HTTP_FLOW_CONTROL_HIGH_WATER_MARK, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.normalize_ae", TS_CONFIG_HTTP_NORMALIZE_AE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.request_header_max_size", TS_CONFIG_HTTP_REQUEST_HEADER_MAX_SIZE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.response_header_max_size", TS_CONFIG_HTTP_RESPONSE_HEADER_MAX_SIZE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.number_of_redirections", TS_CONFIG_HTTP_NUMBER_OF_REDIRECTIONS, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.redirect_use_orig_cache_key", TS_CONFIG_HTTP_REDIRECT_USE_ORIG_CACHE_KEY, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.attach_server_session_to_client", TS_CONFIG_HTTP_ATTACH_SERVER_SESSION_TO_CLIENT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.auth_server_session_private", TS_CONFIG_HTTP_AUTH_SERVER_SESSION_PRIVATE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.slow.log.threshold", TS_CONFIG_HTTP_SLOW_LOG_THRESHOLD, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.post.check.content_length.enabled", TS_CONFIG_HTTP_POST_CHECK_CONTENT_LENGTH_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.parent_proxy.total_connect_attempts", TS_CONFIG_HTTP_PARENT_PROXY_TOTAL_CONNECT_ATTEMPTS, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.uncacheable_requests_bypass_parent", TS_CONFIG_HTTP_UNCACHEABLE_REQUESTS_BYPASS_PARENT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.allow_multi_range", TS_CONFIG_HTTP_ALLOW_MULTI_RANGE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.request_buffer_enabled", TS_CONFIG_HTTP_REQUEST_BUFFER_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.default_buffer_size", TS_CONFIG_HTTP_DEFAULT_BUFFER_SIZE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.default_buffer_water_mark", TS_CONFIG_HTTP_DEFAULT_BUFFER_WATER_MARK, TS_RECORDDATATYPE_INT},
+  {"proxy.config.ssl.hsts_max_age", TS_CONFIG_SSL_HSTS_MAX_AGE, TS_RECORDDATATYPE_INT},
+  {"proxy.config.ssl.hsts_include_subdomains", TS_CONFIG_SSL_HSTS_INCLUDE_SUBDOMAINS, TS_RECORDDATATYPE_INT},
+  {"proxy.config.body_factory.template_base", TS_CONFIG_BODY_FACTORY_TEMPLATE_BASE, TS_RECORDDATATYPE_STRING},
+  {"proxy.config.websocket.no_activity_timeout", TS_CONFIG_WEBSOCKET_NO_ACTIVITY_TIMEOUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.websocket.active_timeout", TS_CONFIG_WEBSOCKET_ACTIVE_TIMEOUT, TS_RECORDDATATYPE_INT},
+  {"proxy.config.srv_enabled", TS_CONFIG_SRV_ENABLED, TS_RECORDDATATYPE_INT},
+  {"proxy.config.http.forward_connect_method", TS_CONFIG_HTTP_FORWARD_CONNECT_METHOD, TS_RECORDDATATYPE_INT},
+};
+
+} // namespace
+/* ------------------------------------------------------------------------------------ */
+
+namespace
+{
+  /** Update the Host field of @a req, if it has one.
+   *
+   * @param req Request.
+   * @param host New host, or empty to keep the current host.
+   * @param port New port, zero to remove the port, or empty to keep the current port.
+   * @return @c true if the field was present.
+   */
+  bool
+  host_field_update(ts::HttpRequest &req, TextView host, std::optional<in_port_t> port)
+  {
+    auto field{req.field(ts::HTTP_FIELD_HOST)};
+    if (!field.is_valid()) {
+      return false;
+    }
+    TextView host_token, port_token;
+    if (!swoc::IPEndpoint::tokenize(field.value(), &host_token, &port_token)) {
+      if (!host.empty()) { // It's messed up, do the best we can by setting it to a valid value.
+        field.assign(host);
+      }
+      return true;
+    }
+    if (host.empty()) {
+      host = host_token;
+    }
+    ScratchArena scratch;
+    // Brackets for an IPv6 address, a colon, and the port.
+    auto buff =
+      scratch.alloc(host.size() + 3 + std::max<size_t>(port_token.size(), std::numeric_limits<in_port_t>::digits10 + 1));
+    swoc::FixedBufferWriter w{buff.data(), buff.size()};
+    if (host.find(':') != TextView::npos && host.front() != '[') { // tokenize strips the brackets.
+      w.write('[').write(host).write(']');
+    } else {
+      w.write(host);
+    }
+    if (port) {
+      if (*port > 0) {
+        w.write(':');
+        bwformat(w, swoc::bwf::Spec::DEFAULT, *port);
+      }
+    } else if (!port_token.empty()) {
+      w.write(':').write(port_token);
+    }
+    field.assign(w.view());
+    return true;
+  }
+} // namespace
 
 BufferWriter &
 ts::URL::write_full(BufferWriter &w) const
@@ -315,6 +550,72 @@ ts::HttpRequest::url_set(TextView text)
   return zret;
 }
 
+unsigned
+ts::URL::update(URLUpdate const &update)
+{
+  unsigned zret = 0;
+  if (!this->is_valid()) {
+    return zret;
+  }
+  // Scheme first, as the computed port depends on it.
+  if (update._scheme && 0 != strcasecmp(this->scheme(), *update._scheme)) {
+    this->scheme_set(*update._scheme);
+    ++zret;
+  }
+  if (update._host && 0 != strcasecmp(this->host(), *update._host)) {
+    this->host_set(*update._host);
+    ++zret;
+  }
+  if (update._port && this->port() != *update._port) {
+    this->port_set(*update._port);
+    ++zret;
+  }
+  if (update._path && this->path() != *update._path) {
+    this->path_set(*update._path);
+    ++zret;
+  }
+  if (update._query && this->query() != *update._query) {
+    this->query_set(*update._query);
+    ++zret;
+  }
+  return zret;
+}
+
+unsigned
+ts::HttpRequest::url_update(URLUpdate const &update)
+{
+  auto url{this->url()};
+  if (!url.is_valid()) {
+    return 0;
+  }
+  // The URL handles everything except host and port, which may also be in the Host field.
+  URLUpdate url_part{update};
+  url_part._host.reset();
+  url_part._port.reset();
+  unsigned zret = url.update(url_part);
+
+  bool host_p = update._host && 0 != strcasecmp(this->host(), *update._host);
+  bool port_p = update._port && this->port() != *update._port;
+  if (host_p && port_p) { // Rewrite the Host field once, as "host:port".
+    if (!url.host().empty()) {
+      url.host_set(*update._host);
+      url.port_set(*update._port);
+      host_field_update(*this, *update._host, *update._port);
+    } else if (!host_field_update(*this, *update._host, *update._port)) { // No host at all.
+      this->host_set(*update._host);
+      this->port_set(*update._port);
+    }
+    zret += 2;
+  } else if (host_p) {
+    this->host_set(*update._host);
+    ++zret;
+  } else if (port_p) {
+    this->port_set(*update._port);
+    ++zret;
+  }
+  return zret;
+}
+
 /* ------------------------------------------------------------------------------------ */
 ts::HttpField::~HttpField()
 {
@@ -456,23 +757,7 @@ ts::HttpRequest::host_set(swoc::TextView const &host)
     url.host_set(host);
     force_host_p = false;
   }
-  auto field{this->field(HTTP_FIELD_HOST)};
-  if (field.is_valid()) {
-    auto text = field.value();
-    TextView host_token, port_token, rest_token;
-    if (swoc::IPEndpoint::tokenize(text, &host_token, &port_token)) {
-      size_t n = host.size() + 1 + port_token.size();
-      swoc::FixedBufferWriter w{static_cast<char *>(alloca(n)), n};
-      if (port_token.size()) {
-        w.print("{}:{}", host, port_token);
-      } else {
-        w.print("{}", host);
-      }
-      field.assign(w.view());
-    } else { // It's messed up, do the best we can by setting it to a valid value.
-      field.assign(host);
-    }
-  } else if (force_host_p) {
+  if (!host_field_update(*this, host, std::nullopt) && force_host_p) {
     this->field_create(HTTP_FIELD_HOST).assign(host);
   }
   return true;
@@ -485,21 +770,7 @@ ts::HttpRequest::port_set(in_port_t port)
   if (!url.host().empty()) {
     url.port_set(port);
   }
-  auto field{this->field(HTTP_FIELD_HOST)};
-  if (field.is_valid()) {
-    auto text = field.value();
-    TextView host_token, port_token, rest_token;
-    if (swoc::IPEndpoint::tokenize(text, &host_token, &port_token)) {
-      size_t n = host_token.size() + 1 + std::numeric_limits<in_port_t>::max_digits10;
-      swoc::FixedBufferWriter w{static_cast<char *>(alloca(n)), n};
-      w.write(host_token);
-      if (port > 0) {
-        w.write(':');
-        bwformat(w, swoc::bwf::Spec::DEFAULT, port);
-      }
-      field.assign(w.view());
-    }
-  }
+  host_field_update(*this, {}, port);
   return true;
 }
 
@@ -647,6 +918,12 @@ ts::HttpTxn::is_internal() const
   return static_cast<bool>(TSHttpTxnIsInternal(_txn));
 }
 
+bool
+ts::HttpTxn::is_aborted() const
+{
+  return compat::txn_aborted(_txn, swoc::meta::CaseArg);
+}
+
 void
 ts::HttpTxn::error_body_set(swoc::TextView body, swoc::TextView content_type)
 {
@@ -713,12 +990,10 @@ ts::HttpSsn::inbound_sni() const
 TextView
 ts::HttpSsn::proto_contains(const swoc::TextView &tag) const
 {
+  ScratchArena scratch;
   TextView probe{tag};
   if (tag.empty() || tag.back() != '\0') {
-    char *span = static_cast<char *>(alloca(tag.size() + 1));
-    memcpy(span, tag.data(), tag.size());
-    span[tag.size()] = '\0';
-    probe.assign(span, tag.size() + 1);
+    probe = scratch.localize_c(tag);
   }
   auto result = TSHttpSsnClientProtocolStackContains(_ssn, probe.data());
   return {result, result ? strlen(result) : 0};
@@ -742,11 +1017,16 @@ int ts::HttpTxn::inbound_fd() const {
   return result != TS_SUCCESS ? -1 : fd;
 }
 
+Status
+ts::HttpTxn::cache_key_set(TextView const &key)
+{
+  return TS_SUCCESS == TSCacheUrlSet(_txn, key.data(), key.size()) ? Status{} : Status{Status::CACHE_KEY_FAILED};
+}
+
 Errata
 ts::HttpTxn::cache_key_assign(TextView const &key)
 {
-  TSCacheUrlSet(_txn, key.data(), key.size());
-  return {};
+  return this->cache_key_set(key).errata();
 }
 
 void *
@@ -767,239 +1047,1443 @@ HttpTxn::outbound_txn_count() const
   return compat::get_outbound_txn_count(_txn, swoc::meta::CaseArg);
 }
 
-swoc::Rv<int>
-HttpTxn::reserve_arg(swoc::TextView const &name, swoc::TextView const &description)
+Status
+HttpTxn::reserve_arg(swoc::TextView const &name, swoc::TextView const &description, int &idx)
 {
-  int idx = -1;
-
   char const *buff = nullptr;
   if (TS_SUCCESS == ts::compat::user_arg_index_name_lookup(name.data(), &idx, &buff)) {
-    return idx;
+    return {};
   }
 
   if (TS_ERROR == ts::compat::user_arg_index_reserve(name.data(), description.data(), &idx)) {
-    return {idx, Errata(S_ERROR, R"(Failed to reserve transaction argument index.)")};
+    return Status::ARG_FAILED;
   }
-  return idx;
+  return {};
 }
 
-TxnConfigVar *
-HttpTxn::find_override(swoc::TextView const &name)
+swoc::Rv<int>
+HttpTxn::reserve_arg(swoc::TextView const &name, swoc::TextView const &description)
 {
-  TSOverridableConfigKey key;
-  TSRecordDataType type;
+  int idx = -1;
+  if (auto status = reserve_arg(name, description, idx); !status.is_ok()) {
+    return {idx, status.errata()};
+  }
+  return idx;
+}
 
-  std::lock_guard lock{_var_table_lock};
+/// Pooled arena for @c ScratchArena.
+struct ScratchArena::Entry {
+  /// Per thread pool of entries.
+  struct Pool {
+    Entry *_head  = nullptr; ///< Free list.
+    size_t _count = 0;       ///< Number of entries in @a _head.
 
-  if (auto spot{_var_table.find(name)}; spot != _var_table.end()) {
-    return spot->second.get();
-  }
+    ~Pool()
+    {
+      while (_head) {
+        delete std::exchange(_head, _head->_next);
+      }
+    }
+  };
 
-  // Does it exist?
-  if (TS_SUCCESS != TSHttpTxnConfigFind(name.data(), name.size(), &key, &type)) {
-    return nullptr;
+  std::unique_ptr<char[]> _block; ///< Static block for @a _arena.
+  size_t _block_size = 0;         ///< Size of @a _block.
+  std::optional<MemArena> _arena; ///< Arena, using @a _block.
+  Entry *_next = nullptr;         ///< Pool link.
+
+  static thread_local Pool _pool; ///< Entries for this thread.
+
+  explicit Entry(size_t n) { this->reset(n); }
+
+  /// Reset the arena to use a block of @a n bytes.
+  void
+  reset(size_t n)
+  {
+    _arena.reset(); // The arena must go before the block it uses.
+    _block.reset(new char[n]);
+    _block_size = n;
+    _arena.emplace(MemSpan<void>{_block.get(), n});
   }
+};
 
-  // It exists, put it in the table and return it.
-  auto var    = new TxnConfigVar{name, key, type};
-  auto result = _var_table.emplace(var->name(), var);
-  return std::get<0>(result)->second.get();
-}
+thread_local ScratchArena::Entry::Pool ScratchArena::Entry::_pool;
 
-Errata
-HttpTxn::override_assign(TxnConfigVar const &var, intmax_t n)
+ScratchArena::ScratchArena()
 {
-  if (!var.is_valid(n)) {
-    return Errata(S_ERROR, R"(Integer value {} is not valid for transaction overridable configuration variable "{}".)", n, var.name());
-  }
-  if (TS_ERROR == TSHttpTxnConfigIntSet(_txn, var.key(), n)) {
-    return Errata(S_ERROR, R"(Integer value {} assignment to transaction overridable configuration variable "{}" failed.)", n, var.name());
+  auto &pool = Entry::_pool;
+  if (pool._head) {
+    _entry = std::exchange(pool._head, pool._head->_next);
+    --pool._count;
+  } else {
+    _entry = new Entry(DEFAULT_BLOCK_SIZE);
   }
-  return {};
 }
 
-Errata
-HttpTxn::override_assign(TxnConfigVar const &var, TextView const &text)
+ScratchArena::ScratchArena(self_type &&that) : _entry(std::exchange(that._entry, nullptr)) {}
+
+ScratchArena::~ScratchArena()
 {
-  if (!var.is_valid(text)) {
-    return Errata(S_ERROR, R"(String value "{}" is not valid for transaction overridable configuration variable "{}".)", text, var.name());
+  if (_entry == nullptr) {
+    return;
   }
-  if (TS_ERROR == TSHttpTxnConfigStringSet(_txn, var.key(), text.data(), text.size())) {
-    return Errata(S_ERROR, R"(String value "{}" assignment to transaction overridable configuration variable "{}" failed.)", text,
-                 var.name());
+  auto &pool = Entry::_pool;
+  if (pool._count >= MAX_POOLED) {
+    delete _entry;
+    return;
   }
-  return {};
+  // If the arena outgrew its block, replace the block with one large enough for the peak use.
+  if (auto peak = _entry->_arena->allocated_size(); peak > _entry->_block_size && _entry->_block_size < MAX_BLOCK_SIZE) {
+    _entry->reset(std::min(peak, MAX_BLOCK_SIZE));
+  } else {
+    _entry->_arena->clear();
+  }
+  _entry->_next = pool._head;
+  pool._head    = _entry;
+  ++pool._count;
 }
 
-Errata
-HttpTxn::override_assign(TxnConfigVar const &var, double f)
+MemArena &
+ScratchArena::operator*()
 {
-  if (!var.is_valid(f)) {
-    return Errata(S_ERROR, R"(Floating value {} is not valid for transaction overridable configuration variable "{}".)", var.name());
-  }
-  if (TS_ERROR == TSHttpTxnConfigFloatSet(_txn, var.key(), f)) {
-    return Errata(S_ERROR, R"(Floating value {} assignment to transaction overridable configuration variable "{}" failed.)", var.name());
-  }
-  return {};
+  return *_entry->_arena;
 }
 
-Rv<ConfVarData>
-HttpTxn::override_fetch(const TxnConfigVar &var)
+MemArena *
+ScratchArena::operator->()
 {
-  switch (var.type()) {
-  case TS_RECORDDATATYPE_FLOAT: {
-    TSMgmtFloat v;
-    if (TS_SUCCESS == TSHttpTxnConfigFloatGet(_txn, var.key(), &v)) {
-      return ConfVarData{v};
-    }
-    break;
-  }
-  case TS_RECORDDATATYPE_STRING: {
-    char const *text;
-    int len;
-    if (TS_SUCCESS == TSHttpTxnConfigStringGet(_txn, var.key(), &text, &len)) {
-      return ConfVarData{TextView{text, size_t(len)}};
-    }
-    break;
-  }
-  case TS_RECORDDATATYPE_INT: {
-    TSMgmtInt v;
-    if (TS_SUCCESS == TSHttpTxnConfigIntGet(_txn, var.key(), &v)) {
-      return ConfVarData{v};
-    }
-    break;
-  }
-  default:
-    return Errata(S_ERROR, "Var '{}' does not have a valid data type [{}]", var.name(), var.type());
-    break;
-  }
-  return Errata(S_ERROR, R"(Failed to retrieve config variable "{})", var.name());
+  return &*_entry->_arena;
 }
 
-int
-HttpSsn::protocol_stack(MemSpan<const char *> tags) const
+MemSpan<char>
+ScratchArena::alloc(size_t n)
 {
-  int n = 0;
-  if (TS_SUCCESS != TSHttpSsnClientProtocolStackGet(_ssn, tags.count(), tags.data(), &n)) {
-    return -1;
-  }
-  return n;
+  return _entry->_arena->alloc(n).rebind<char>();
 }
 
-// ----
-
-int
-plugin_stat_value(int idx)
+TextView
+ScratchArena::localize_c(TextView const &text)
 {
-  return TSStatIntGet(idx);
+  auto span = this->alloc(text.size() + 1);
+  memcpy(span.data(), text.data(), text.size());
+  span[text.size()] = '\0';
+  return {span.data(), text.size()};
 }
 
-int
-plugin_stat_index(TextView const &name)
+/** Transaction or session local storage.
+ *
+ * This is allocated in the arena it owns. Finalizers are allocated in the arena as well.
+ */
+class LocalStorage
 {
-  int idx;
-  if (TS_SUCCESS == TSStatFindName(name.data(), &idx)) {
-    return idx;
+  using self_type = LocalStorage; ///< Self reference type.
+public:
+  explicit LocalStorage(ScratchArena &&arena) : _arena(std::move(arena)) {}
+
+  /** Create an instance.
+   *
+   * @param n_slots Initial number of slots.
+   * @return The instance.
+   */
+  static self_type *make(unsigned n_slots);
+
+  /// Call the finalizers and release @a this.
+  void release();
+
+  /// @return The arena.
+  MemArena &
+  arena()
+  {
+    return *_arena;
   }
-  return -1;
+
+  /// @return The value of slot @a idx, or @c nullptr if not set.
+  void *
+  slot(unsigned idx) const
+  {
+    return idx < _slots.count() ? _slots[idx] : nullptr;
+  }
+
+  /** Set slot @a idx to @a value.
+   *
+   * @param idx Slot index.
+   * @param value Value to set.
+   * @param n_slots Number of reserved slots, used if @a idx was reserved after @a this was created.
+   */
+  void slot_assign(unsigned idx, void *value, unsigned n_slots);
+
+  /// Call @a f with @a obj when @a this is released.
+  void finalizer_add(void (*f)(void *), void *obj);
+
+protected:
+  /// Finalizer list element.
+  struct Finalizer {
+    void (*_f)(void *) = nullptr; ///< Finalizer function.
+    void *_obj         = nullptr; ///< Argument for @a _f.
+    Finalizer *_next   = nullptr; ///< Next finalizer to call.
+  };
+
+  ScratchArena _arena;              ///< Arena, which contains @a this.
+  Finalizer *_finalizers = nullptr; ///< Finalizers, most recently added first.
+  MemSpan<void *> _slots;           ///< Slot values.
+
+  /// Make room for @a n slots.
+  void slots_resize(unsigned n);
+};
+
+auto
+LocalStorage::make(unsigned n_slots) -> self_type *
+{
+  NetThreadRegister(); // Storage is created by plugin code on network threads.
+  ScratchArena arena;
+  auto &a    = *arena;
+  auto store = a.make<self_type>(std::move(arena));
+  store->slots_resize(n_slots);
+  return store;
 }
 
-Rv<int>
-plugin_stat_define(TextView const &name, int value, bool persistent_p)
+void
+LocalStorage::slots_resize(unsigned n)
 {
-  int idx = plugin_stat_index(name);
-  if (idx >= 0) { // Already there, just return the index.
-    return idx;
-  }
-  // Create the stat.
-  idx = TSStatCreate(name.data(), TS_RECORDDATATYPE_INT, (persistent_p ? TS_STAT_PERSISTENT : TS_STAT_NON_PERSISTENT),
-                     TS_STAT_SYNC_SUM);
-  if (idx == TS_ERROR) {
-    return Errata(S_ERROR, "Failed to create stat '{}'", name);
+  auto slots = _arena->alloc(n * sizeof(void *)).rebind<void *>();
+  std::copy(_slots.begin(), _slots.end(), slots.begin());
+  std::fill(slots.begin() + _slots.count(), slots.end(), nullptr);
+  _slots = slots;
+}
+
+void
+LocalStorage::slot_assign(unsigned idx, void *value, unsigned n_slots)
+{
+  if (idx >= _slots.count()) {
+    this->slots_resize(std::max(n_slots, idx + 1));
   }
-  TSStatIntSet(idx, value);
-  return idx;
+  _slots[idx] = value;
 }
 
 void
-plugin_stat_update(int idx, intmax_t value)
+LocalStorage::finalizer_add(void (*f)(void *), void *obj)
 {
-  TSStatIntIncrement(idx, value);
+  auto finalizer   = _arena->make<Finalizer>();
+  finalizer->_f    = f;
+  finalizer->_obj  = obj;
+  finalizer->_next = _finalizers;
+  _finalizers      = finalizer;
 }
 
-// ----
 void
-TaskHandle::cancel()
+LocalStorage::release()
 {
-  if (_action != nullptr) {
-    TSMutex m = TSContMutexGet(_cont);
-    auto data = static_cast<Data *>(TSContDataGet(_cont));
-    // Work around for TS shutdown - if this is cleaned up during shutdown, it's done on TS_MAIN
-    // which should have cleared its @c EThread data. If that's the case, though, there's
-    // no point in worrying about locks because the ET_NET threads aren't running. The
-    // @c Continuation can't be cleaned up because it's now thread allocated and there's no longer
-    // a thread freelist to use. Trying to do that will crash.
-    if (TSThreadSelf() == nullptr) {
-      delete data;
-    } else if (TSMutexLockTry(m)) {
-      TSActionCancel(_action);
-      // The task is not running at this point because the lock is held and now that it's been
-      // canceled it won't run again. Therefore it can be unlocked and cleaned up safely.
-      TSMutexUnlock(m);
-      delete data;
-      TSContDestroy(_cont);
-    } else {
-      // Signal the task lambda (which has the lock) that it should clean up.
-      data->_active = false;
-    }
-    _action = nullptr; // Don't cancel again.
+  while (_finalizers) {
+    auto f = std::exchange(_finalizers, _finalizers->_next);
+    f->_f(f->_obj);
   }
+  // @a this is in the arena - move the arena out so it outlives @a this.
+  ScratchArena arena{std::move(_arena)};
+  this->~LocalStorage();
 }
 
-TaskHandle
-PerformAsTask(std::function<void()> &&task)
+namespace
 {
-  static auto lambda = [](TSCont contp, TSEvent, void *) -> int {
-    auto data = static_cast<TaskHandle::Data *>(TSContDataGet(contp));
-    if (data->_active) {
-      data->_f();
-    }
-    delete data;
-    TSContDestroy(contp);
-    return 0;
-  };
+  TSCont Txn_Storage_Close = nullptr; ///< Release transaction storage.
+  TSCont Ssn_Storage_Close = nullptr; ///< Release session storage.
 
-  auto contp = TSContCreate(lambda, TSMutexCreate());
-  auto data  = new TaskHandle::Data(std::move(task));
-  TSContDataSet(contp, data);
-  return {TSContScheduleOnPool(contp, 0, TS_THREAD_POOL_TASK), contp};
-}
+  /// Locks for session storage, shared by sessions with the same hash.
+  std::array<std::recursive_mutex, 64> Ssn_Storage_Locks;
+} // namespace
 
-TaskHandle
-PerformAsTaskEvery(std::function<void()> &&task, std::chrono::milliseconds period)
-{
-  // The lambda runs under lock for the continuation mutex, therefore it can cancel as needed.
-  // External cancel tries the lock - if that succeeds it can cancel and prevent the lambda
-  // entirely. If not, @a _active is set to @c false. This can be a race that's missed but
-  // it will be detected the next time the task runs.
-  static auto lambda = [](TSCont contp, TSEvent, void *event) -> int {
-    auto data = static_cast<TaskHandle::Data *>(TSContDataGet(contp));
-    if (data->_active) {
-      data->_f();
-    }
+Status
+HttpTxn::storage_init()
+{
+  static std::mutex init_lock; // Serialize lazy initialization from transaction threads.
 
-    // If not active, then the task has been canceled - clean up.
-    if (!data->_active) {
-      TSActionCancel(static_cast<TSAction>(event));
-      delete data;
-      TSContDestroy(contp);
+  if (_arg_idx >= 0) {
+    return {};
+  }
+  std::lock_guard lock(init_lock);
+  if (_arg_idx >= 0) { // Done by another thread while waiting for the lock.
+    return {};
+  }
+  int idx = -1;
+  if (auto status = reserve_arg("swoc_ts_api.storage", "Transaction local storage", idx); !status.is_ok()) {
+    return status;
+  }
+  Txn_Storage_Close = TSContCreate(
+    [](TSCont, TSEvent, void *data) -> int {
+      auto txnp = static_cast<TSHttpTxn>(data);
+      if (auto store = static_cast<LocalStorage *>(compat::user_arg_get(txnp, _arg_idx)); store != nullptr) {
+        compat::user_arg_set(txnp, _arg_idx, nullptr);
+        store->release();
+      }
+      TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+      return 0;
+    },
+    nullptr);
+  _arg_idx = idx; // Publish after the close continuation is ready.
+  return {};
+}
+
+LocalStorage *
+HttpTxn::storage()
+{
+  if (_arg_idx < 0) { // Storage used without a slot being reserved, e.g. only the arena.
+    auto status = storage_init();
+    TSReleaseAssert(status.is_ok());
+  }
+  auto store = static_cast<LocalStorage *>(this->arg(_arg_idx));
+  if (store == nullptr) {
+    store = LocalStorage::make(_slot_count);
+    this->arg_assign(_arg_idx, store);
+    TSHttpTxnHookAdd(_txn, TS_HTTP_TXN_CLOSE_HOOK, Txn_Storage_Close);
+  }
+  return store;
+}
+
+Status
+HttpTxn::slot_reserve(unsigned &idx)
+{
+  if (auto status = storage_init(); !status.is_ok()) {
+    return status;
+  }
+  idx = _slot_count++;
+  return {};
+}
+
+void *
+HttpTxn::slot(unsigned idx)
+{
+  if (_arg_idx < 0) {
+    return nullptr;
+  }
+  auto store = static_cast<LocalStorage *>(this->arg(_arg_idx));
+  return store ? store->slot(idx) : nullptr;
+}
+
+void
+HttpTxn::slot_assign(unsigned idx, void *value)
+{
+  this->storage()->slot_assign(idx, value, _slot_count);
+}
+
+MemArena &
+HttpTxn::arena()
+{
+  return this->storage()->arena();
+}
+
+void
+HttpTxn::finalizer_add(void (*f)(void *), void *obj)
+{
+  this->storage()->finalizer_add(f, obj);
+}
+
+/* ------------------------------------------------------------------------------------ */
+
+/// Session values computed at most once.
+struct HttpSsn::Cache {
+  /// A client certificate field.
+  struct CertField {
+    int _nid       = 0;     ///< Field identifier.
+    bool _issuer_p = false; ///< Issuer if @c true, subject if @c false.
+    TextView _value;        ///< Field value.
+  };
+
+  static constexpr size_t MAX_CERT_FIELDS = 8; ///< Maximum number of cached certificate fields.
+
+  std::optional<TextView> _sni;                        ///< Inbound SNI.
+  std::optional<MemSpan<char const *>> _tags;          ///< Protocol stack.
+  std::optional<AddrClass> _addr_class;                ///< Remote address class.
+  std::array<CertField, MAX_CERT_FIELDS> _cert_fields; ///< Client certificate fields.
+  unsigned _n_cert_fields = 0;                         ///< Number of valid elements in @a _cert_fields.
+};
+
+Status
+HttpSsn::storage_init()
+{
+  static std::mutex init_lock; // Serialize lazy initialization from transaction threads.
+
+  if (_arg_idx >= 0) {
+    return {};
+  }
+  std::lock_guard lock(init_lock);
+  if (_arg_idx >= 0) { // Done by another thread while waiting for the lock.
+    return {};
+  }
+  int idx = -1;
+  if (TS_ERROR == compat::ssn_arg_index_reserve("swoc_ts_api.storage", "Session local storage", &idx)) {
+    return Status::ARG_FAILED;
+  }
+  _cache_slot       = _slot_count++;
+  Ssn_Storage_Close = TSContCreate(
+    [](TSCont, TSEvent, void *data) -> int {
+      auto ssnp = static_cast<TSHttpSsn>(data);
+      if (auto store = static_cast<LocalStorage *>(compat::ssn_arg_get(ssnp, _arg_idx)); store != nullptr) {
+        compat::ssn_arg_set(ssnp, _arg_idx, nullptr);
+        store->release();
+      }
+      TSHttpSsnReenable(ssnp, TS_EVENT_HTTP_CONTINUE);
+      return 0;
+    },
+    nullptr);
+  _arg_idx = idx; // Publish after the close continuation is ready.
+  return {};
+}
+
+std::unique_lock<std::recursive_mutex>
+HttpSsn::lock()
+{
+  auto h = std::hash<void *>()(_ssn);
+  return std::unique_lock{Ssn_Storage_Locks[(h ^ (h >> 12)) % Ssn_Storage_Locks.size()]};
+}
+
+LocalStorage *
+HttpSsn::storage()
+{
+  if (_arg_idx < 0) { // Storage used without a slot being reserved, e.g. only the arena.
+    auto status = storage_init();
+    TSReleaseAssert(status.is_ok());
+  }
+  auto lock  = this->lock();
+  auto store = static_cast<LocalStorage *>(compat::ssn_arg_get(_ssn, _arg_idx));
+  if (store == nullptr) {
+    store = LocalStorage::make(_slot_count);
+    compat::ssn_arg_set(_ssn, _arg_idx, store);
+    TSHttpSsnHookAdd(_ssn, TS_HTTP_SSN_CLOSE_HOOK, Ssn_Storage_Close);
+  }
+  return store;
+}
+
+Status
+HttpSsn::slot_reserve(unsigned &idx)
+{
+  if (auto status = storage_init(); !status.is_ok()) {
+    return status;
+  }
+  idx = _slot_count++;
+  return {};
+}
+
+void *
+HttpSsn::slot(unsigned idx)
+{
+  if (_arg_idx < 0) {
+    return nullptr;
+  }
+  auto lock  = this->lock();
+  auto store = static_cast<LocalStorage *>(compat::ssn_arg_get(_ssn, _arg_idx));
+  return store ? store->slot(idx) : nullptr;
+}
+
+void
+HttpSsn::slot_assign(unsigned idx, void *value)
+{
+  auto lock = this->lock();
+  this->storage()->slot_assign(idx, value, _slot_count);
+}
+
+MemArena &
+HttpSsn::arena()
+{
+  return this->storage()->arena();
+}
+
+void
+HttpSsn::finalizer_add(void (*f)(void *), void *obj)
+{
+  auto lock = this->lock();
+  this->storage()->finalizer_add(f, obj);
+}
+
+auto
+HttpSsn::cache() -> Cache &
+{
+  auto cache = static_cast<Cache *>(this->slot(_cache_slot));
+  if (cache == nullptr) {
+    cache = this->arena().make<Cache>(); // trivially destructible, no finalizer needed.
+    this->slot_assign(_cache_slot, cache);
+  }
+  return *cache;
+}
+
+TextView
+HttpSsn::sni()
+{
+  auto lock   = this->lock();
+  auto &cache = this->cache();
+  if (!cache._sni) {
+    cache._sni = this->inbound_sni();
+  }
+  return *cache._sni;
+}
+
+MemSpan<char const *>
+HttpSsn::protocol_tags()
+{
+  static constexpr size_t MAX_TAGS = 10;
+  auto lock                        = this->lock();
+  auto &cache                      = this->cache();
+  if (!cache._tags) {
+    std::array<char const *, MAX_TAGS> tags;
+    int n = std::clamp(this->protocol_stack({tags.data(), tags.size()}), 0, int(MAX_TAGS));
+    // Tags are static strings in TS, only the array needs to be kept.
+    auto span = this->arena().alloc(n * sizeof(char const *)).rebind<char const *>();
+    std::copy_n(tags.begin(), n, span.begin());
+    cache._tags = span;
+  }
+  return *cache._tags;
+}
+
+TextView
+HttpSsn::remote_cert_field(int nid, bool issuer_p)
+{
+  auto lock       = this->lock();
+  auto &cache     = this->cache();
+  auto cert_begin = cache._cert_fields.begin();
+  auto cert_end   = cert_begin + cache._n_cert_fields;
+  auto match      = [=](Cache::CertField const &f) { return f._nid == nid && f._issuer_p == issuer_p; };
+  if (auto spot = std::find_if(cert_begin, cert_end, match); spot != cert_end) {
+    return spot->_value;
+  }
+  auto ssl   = this->ssl_context();
+  auto value = issuer_p ? ssl.remote_issuer_value(nid) : ssl.remote_subject_value(nid);
+  // Values are in the peer certificate, which is kept for the life of the session.
+  if (cache._n_cert_fields < cache._cert_fields.size()) {
+    cache._cert_fields[cache._n_cert_fields++] = {nid, issuer_p, value};
+  }
+  return value;
+}
+
+TextView
+HttpSsn::remote_subject_field(int nid)
+{
+  return this->remote_cert_field(nid, false);
+}
+
+TextView
+HttpSsn::remote_issuer_field(int nid)
+{
+  return this->remote_cert_field(nid, true);
+}
+
+auto
+HttpSsn::addr_remote_class() -> AddrClass
+{
+  auto lock   = this->lock();
+  auto &cache = this->cache();
+  if (!cache._addr_class) {
+    swoc::IPAddr addr{this->addr_remote()};
+    if (!addr.is_valid()) {
+      cache._addr_class = AddrClass::INVALID;
+    } else if (addr.is_loopback()) {
+      cache._addr_class = AddrClass::LOOPBACK;
+    } else if (addr.is_private()) {
+      cache._addr_class = AddrClass::PRIVATE;
+    } else {
+      cache._addr_class = AddrClass::PUBLIC;
+    }
+  }
+  return *cache._addr_class;
+}
+
+uint64_t
+HttpTxn::var_phash(swoc::TextView const &name, uint64_t seed)
+{
+  // FNV-1a, with the seed mixed in to the offset basis.
+  uint64_t h = 0xcbf29ce484222325ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+  for (char c : name) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 0x100000001b3ULL;
+  }
+  return h ^ (h >> 29);
+}
+
+void
+HttpTxn::preload_overrides()
+{
+  std::call_once(_var_preload_flag, []() -> void {
+    std::vector<TxnConfigVar *> vars;
+    {
+      std::lock_guard lock{_var_table_lock};
+      for (auto const &def : TXN_CONFIG_VAR_DEFS) {
+        TSOverridableConfigKey key;
+        TSRecordDataType type;
+        if (TS_SUCCESS != TSHttpTxnConfigFind(def._name.data(), def._name.size(), &key, &type)) {
+          continue; // Not in this version of TS.
+        }
+        if (key != def._key || type != def._type) {
+          DebugMsg(R"(Overridable configuration variable "{}" is not the compiled in key or type - {} {} vs. {} {})", def._name,
+                   int(key), type, int(def._key), def._type);
+        }
+        auto var = _var_store.emplace_back(new TxnConfigVar{def._name, key, type}).get();
+        if (0 <= key && key < TS_CONFIG_LAST_ENTRY) {
+          _var_by_key[key] = var;
+        }
+        vars.push_back(var);
+      }
+    }
+
+    // Find a seed for which there are no collisions. With the table at least twice the number of
+    // names that is quick, but grow the table if it's not working out.
+    size_t n = 1;
+    while (n < 2 * vars.size()) {
+      n <<= 1;
+    }
+    for (uint64_t seed = 1;; ++seed) {
+      if (seed % 64 == 0) {
+        n <<= 1;
+      }
+      std::vector<TxnConfigVar *> table(n, nullptr);
+      bool collision_p = false;
+      for (auto var : vars) {
+        auto &slot = table[var_phash(var->name(), seed) & (n - 1)];
+        if (slot != nullptr) {
+          collision_p = true;
+          break;
+        }
+        slot = var;
+      }
+      if (!collision_p) {
+        _var_phash      = std::move(table);
+        _var_phash_seed = seed;
+        break;
+      }
+    }
+  });
+}
+
+TxnConfigVar *
+HttpTxn::find_override(TSOverridableConfigKey key)
+{
+  preload_overrides();
+  return (0 <= key && key < TS_CONFIG_LAST_ENTRY) ? _var_by_key[key] : nullptr;
+}
+
+TxnConfigVar *
+HttpTxn::find_override(swoc::TextView const &name)
+{
+  TSOverridableConfigKey key;
+  TSRecordDataType type;
+
+  preload_overrides();
+  if (auto var = _var_phash[var_phash(name, _var_phash_seed) & (_var_phash.size() - 1)]; var != nullptr && var->name() == name) {
+    return var;
+  }
+
+  if (auto table = _var_table.load(std::memory_order_acquire); table != nullptr) {
+    if (auto spot{table->find(name)}; spot != table->end()) {
+      return spot->second;
+    }
+  }
+
+  // Does it exist?
+  if (TS_SUCCESS != TSHttpTxnConfigFind(name.data(), name.size(), &key, &type)) {
+    return nullptr;
+  }
+
+  // It exists, put it in a new table and return it.
+  std::lock_guard lock{_var_table_lock};
+  auto current = _var_table.load(std::memory_order_relaxed);
+  if (current != nullptr) { // Check again, it may have been added while not locked.
+    if (auto spot{current->find(name)}; spot != current->end()) {
+      return spot->second;
+    }
+  }
+
+  auto var   = _var_store.emplace_back(new TxnConfigVar{name, key, type}).get();
+  auto table = current ? new TxnConfigVarTable(*current) : new TxnConfigVarTable;
+  table->emplace(var->name(), var);
+  _var_table.store(table, std::memory_order_release);
+  if (current != nullptr) {
+    _var_table_retired.emplace_back(current);
+  }
+  return var;
+}
+
+Status
+HttpTxn::override_set(TxnConfigVar const &var, intmax_t n)
+{
+  if (!var.is_valid(n)) {
+    return {Status::INVALID_VALUE, &var, n};
+  }
+  if (TS_ERROR == TSHttpTxnConfigIntSet(_txn, var.key(), n)) {
+    return {Status::ASSIGN_FAILED, &var, n};
+  }
+  return {};
+}
+
+Status
+HttpTxn::override_set(TxnConfigVar const &var, TextView const &text)
+{
+  if (!var.is_valid(text)) {
+    return {Status::INVALID_VALUE, &var, text};
+  }
+  if (TS_ERROR == TSHttpTxnConfigStringSet(_txn, var.key(), text.data(), text.size())) {
+    return {Status::ASSIGN_FAILED, &var, text};
+  }
+  return {};
+}
+
+Status
+HttpTxn::override_set(TxnConfigVar const &var, double f)
+{
+  if (!var.is_valid(f)) {
+    return {Status::INVALID_VALUE, &var, f};
+  }
+  if (TS_ERROR == TSHttpTxnConfigFloatSet(_txn, var.key(), f)) {
+    return {Status::ASSIGN_FAILED, &var, f};
+  }
+  return {};
+}
+
+Errata
+HttpTxn::override_assign(TxnConfigVar const &var, intmax_t n)
+{
+  return this->override_set(var, n).errata();
+}
+
+Errata
+HttpTxn::override_assign(TxnConfigVar const &var, TextView const &text)
+{
+  return this->override_set(var, text).errata();
+}
+
+Errata
+HttpTxn::override_assign(TxnConfigVar const &var, double f)
+{
+  return this->override_set(var, f).errata();
+}
+
+Status
+HttpTxn::override_fetch(const TxnConfigVar &var, ConfVarData &value)
+{
+  switch (var.type()) {
+  case TS_RECORDDATATYPE_FLOAT: {
+    TSMgmtFloat v;
+    if (TS_SUCCESS == TSHttpTxnConfigFloatGet(_txn, var.key(), &v)) {
+      value = double(v);
+      return {};
+    }
+    break;
+  }
+  case TS_RECORDDATATYPE_STRING: {
+    char const *text;
+    int len;
+    if (TS_SUCCESS == TSHttpTxnConfigStringGet(_txn, var.key(), &text, &len)) {
+      value = TextView{text, size_t(len)};
+      return {};
+    }
+    break;
+  }
+  case TS_RECORDDATATYPE_INT: {
+    TSMgmtInt v;
+    if (TS_SUCCESS == TSHttpTxnConfigIntGet(_txn, var.key(), &v)) {
+      value = intmax_t(v);
+      return {};
+    }
+    break;
+  }
+  default:
+    return {Status::INVALID_TYPE, &var};
+  }
+  return {Status::FETCH_FAILED, &var};
+}
+
+Rv<ConfVarData>
+HttpTxn::override_fetch(const TxnConfigVar &var)
+{
+  ConfVarData value;
+  if (auto status = this->override_fetch(var, value); !status.is_ok()) {
+    return status.errata();
+  }
+  return value;
+}
+
+Errata
+Status::errata() const
+{
+  if (this->is_ok()) {
+    return {};
+  }
+  return Errata(S_ERROR, "{}", *this);
+}
+
+auto
+OverrideBundle::item(TxnConfigVar const &var) -> Item &
+{
+  auto spot = std::find_if(_items.begin(), _items.end(), [&](Item const &item) { return item._key == var.key(); });
+  if (spot != _items.end()) {
+    return *spot;
+  }
+  return _items.emplace_back(Item{var.key(), var.type()});
+}
+
+Errata
+OverrideBundle::add(TxnConfigVar const &var, intmax_t n)
+{
+  if (!var.is_valid(n)) {
+    return Errata(S_ERROR, R"(Integer value {} is not valid for transaction overridable configuration variable "{}".)", n, var.name());
+  }
+  this->item(var)._n = n;
+  return {};
+}
+
+Errata
+OverrideBundle::add(TxnConfigVar const &var, double f)
+{
+  if (!var.is_valid(f)) {
+    return Errata(S_ERROR, R"(Floating value {} is not valid for transaction overridable configuration variable "{}".)", f, var.name());
+  }
+  this->item(var)._f = f;
+  return {};
+}
+
+Errata
+OverrideBundle::add(TxnConfigVar const &var, TextView const &text)
+{
+  if (!var.is_valid(text)) {
+    return Errata(S_ERROR, R"(String value "{}" is not valid for transaction overridable configuration variable "{}".)", text, var.name());
+  }
+  auto span = _arena.alloc(text.size()).rebind<char>();
+  memcpy(span.data(), text.data(), text.size());
+  this->item(var)._text = TextView{span.data(), span.count()};
+  return {};
+}
+
+unsigned
+OverrideBundle::apply(HttpTxn &txn) const
+{
+  unsigned zret = 0;
+  for (auto const &item : _items) {
+    TSReturnCode rc = TS_ERROR;
+    switch (item._type) {
+    case TS_RECORDDATATYPE_INT:
+      rc = TSHttpTxnConfigIntSet(txn, item._key, item._n);
+      break;
+    case TS_RECORDDATATYPE_FLOAT:
+      rc = TSHttpTxnConfigFloatSet(txn, item._key, item._f);
+      break;
+    case TS_RECORDDATATYPE_STRING:
+      rc = TSHttpTxnConfigStringSet(txn, item._key, item._text.data(), item._text.size());
+      break;
+    default:
+      break;
+    }
+    if (rc != TS_SUCCESS) {
+      ++zret;
+    }
+  }
+  return zret;
+}
+
+int
+HttpSsn::protocol_stack(MemSpan<const char *> tags) const
+{
+  int n = 0;
+  if (TS_SUCCESS != TSHttpSsnClientProtocolStackGet(_ssn, tags.count(), tags.data(), &n)) {
+    return -1;
+  }
+  return n;
+}
+
+// ----
+
+int
+plugin_stat_value(int idx)
+{
+  return TSStatIntGet(idx);
+}
+
+int
+plugin_stat_index(TextView const &name)
+{
+  int idx;
+  if (TS_SUCCESS == TSStatFindName(name.data(), &idx)) {
+    return idx;
+  }
+  return -1;
+}
+
+Rv<int>
+plugin_stat_define(TextView const &name, int value, bool persistent_p)
+{
+  int idx = plugin_stat_index(name);
+  if (idx >= 0) { // Already there, just return the index.
+    return idx;
+  }
+  // Create the stat.
+  idx = TSStatCreate(name.data(), TS_RECORDDATATYPE_INT, (persistent_p ? TS_STAT_PERSISTENT : TS_STAT_NON_PERSISTENT),
+                     TS_STAT_SYNC_SUM);
+  if (idx == TS_ERROR) {
+    return Errata(S_ERROR, "Failed to create stat '{}'", name);
+  }
+  TSStatIntSet(idx, value);
+  return idx;
+}
+
+void
+plugin_stat_update(int idx, intmax_t value)
+{
+  TSStatIntIncrement(idx, value);
+}
+
+// ----
+
+namespace
+{
+  std::mutex Task_Stats_Lock;                                                ///< Lock for @a Task_Stats.
+  std::map<std::string, std::unique_ptr<TaskStats>, std::less<>> Task_Stats; ///< Defined task stats.
+} // namespace
+
+auto
+TaskStats::define(TextView name, std::chrono::milliseconds budget) -> Rv<self_type const *>
+{
+  static constexpr std::array<TextView, N_BUCKETS> BUCKET_NAMES = {"le_100us", "le_1ms", "le_10ms", "le_100ms", "le_1s", "gt_1s"};
+
+  std::lock_guard lock(Task_Stats_Lock);
+  if (auto spot = Task_Stats.find(name); spot != Task_Stats.end()) {
+    return spot->second.get();
+  }
+
+  std::unique_ptr<self_type> stats{new self_type};
+  std::string stat_name;
+  Errata errata;
+  auto stat_define = [&](int &idx, TextView suffix, TextView bucket = {}) -> void {
+    if (bucket.empty()) {
+      swoc::bwprint(stat_name, "{}.{}", name, suffix);
+    } else {
+      swoc::bwprint(stat_name, "{}.{}.{}", name, suffix, bucket);
+    }
+    if (auto rv = plugin_stat_define(stat_name, 0, false); rv.is_ok()) {
+      idx = rv.result();
+    } else if (errata.is_ok()) { // Keep the first failure.
+      errata = std::move(rv.errata());
+    }
+  };
+
+  stat_define(stats->_count, "count");
+  stat_define(stats->_queue_delay, "queue_delay_us");
+  stat_define(stats->_run_time, "run_time_us");
+  stat_define(stats->_overrun, "overrun");
+  for (size_t idx = 0; idx < N_BUCKETS; ++idx) {
+    stat_define(stats->_queue_hist[idx], "queue_delay", BUCKET_NAMES[idx]);
+    stat_define(stats->_run_hist[idx], "run_time", BUCKET_NAMES[idx]);
+  }
+  if (!errata.is_ok()) {
+    return std::move(errata);
+  }
+  stats->_budget = budget;
+  return Task_Stats.emplace(name, std::move(stats)).first->second.get();
+}
+
+size_t
+TaskStats::bucket(std::chrono::microseconds t)
+{
+  return std::upper_bound(BUCKET_LIMITS.begin(), BUCKET_LIMITS.end(), t.count() - 1) - BUCKET_LIMITS.begin();
+}
+
+void
+TaskStats::record(std::chrono::microseconds queue_delay, std::chrono::microseconds run_time, std::chrono::milliseconds period) const
+{
+  plugin_stat_update(_count, 1);
+  plugin_stat_update(_queue_delay, queue_delay.count());
+  plugin_stat_update(_queue_hist[bucket(queue_delay)], 1);
+  plugin_stat_update(_run_time, run_time.count());
+  plugin_stat_update(_run_hist[bucket(run_time)], 1);
+  if (auto limit = _budget.count() ? _budget : period; limit.count() && run_time > limit) {
+    plugin_stat_update(_overrun, 1);
+  }
+}
+
+// ----
+/** Pooled task data.
+ *
+ * The continuation and its mutex are created once and reused for every task run with this data.
+ * @a _state has the generation in the upper bits and an active flag in the low bit. It is changed
+ * with compare and swap so that a stale handle cannot cancel a later task.
+ */
+struct TaskHandle::Data {
+  static constexpr uint64_t ACTIVE   = 1;   ///< Active flag in @a _state.
+  static constexpr size_t MAX_POOLED = 256; ///< Maximum number of pooled instances.
+
+  TSCont _cont = nullptr;                     ///< Continuation, reused.
+  TaskFunction _f;                            ///< Task functor.
+  std::atomic<uint64_t> _state{0};            ///< Generation and active flag.
+  bool _periodic_p        = false;            ///< Task is periodic.
+  bool _dispatching_p     = false;            ///< The functor is running, under the continuation lock.
+  Data *_next             = nullptr;          ///< Pool link.
+  TaskStats const *_stats = nullptr;          ///< Instrumentation, if any.
+  std::chrono::milliseconds _period{0};       ///< Period, if instrumented and periodic.
+  std::chrono::steady_clock::time_point _due; ///< When the next run is due, if instrumented.
+
+  /** Get an instance from the pool, or create one.
+   *
+   * @param f Task functor.
+   * @param periodic_p Task is periodic.
+   * @param stats Instrumentation, or @c nullptr for none.
+   * @param delay Time until the first run.
+   * @return An active instance for a new generation.
+   */
+  static Data *acquire(TaskFunction &&f, bool periodic_p, TaskStats const *stats = nullptr,
+                       std::chrono::milliseconds delay = std::chrono::milliseconds{0});
+
+  /// Run the functor and record the times in @a _stats.
+  void run_instrumented();
+
+  /// @return The current generation.
+  uint32_t
+  generation() const
+  {
+    return uint32_t(_state >> 1);
+  }
+
+  /** Mark the task inactive.
+   *
+   * @param gen Generation of the task.
+   * @return @c true if the task was active and for generation @a gen.
+   */
+  bool
+  deactivate(uint32_t gen)
+  {
+    uint64_t expected = uint64_t(gen) << 1 | ACTIVE;
+    return _state.compare_exchange_strong(expected, uint64_t(gen) << 1);
+  }
+
+  /// Clear the task and return @a this to the pool. The task must not be scheduled.
+  void recycle();
+
+  /// Continuation handler.
+  static int dispatch(TSCont contp, TSEvent, void *event);
+};
+
+namespace
+{
+  std::mutex Task_Pool_Lock;             ///< Lock for the task pool.
+  TaskHandle::Data *Task_Pool = nullptr; ///< Free list of task data.
+  size_t Task_Pool_Count      = 0;       ///< Number of elements in @a Task_Pool.
+} // namespace
+
+auto
+TaskHandle::Data::acquire(TaskFunction &&f, bool periodic_p, TaskStats const *stats, std::chrono::milliseconds delay) -> Data *
+{
+  Data *data = nullptr;
+  {
+    std::lock_guard lock(Task_Pool_Lock);
+    if (Task_Pool) {
+      data = std::exchange(Task_Pool, Task_Pool->_next);
+      --Task_Pool_Count;
+    }
+  }
+  if (data == nullptr) {
+    data        = new Data;
+    data->_cont = TSContCreate(&Data::dispatch, TSMutexCreate());
+    TSContDataSet(data->_cont, data);
+  }
+  data->_f          = std::move(f);
+  data->_periodic_p = periodic_p;
+  data->_stats      = stats;
+  if (stats) { // Only read the clock if it will be used.
+    data->_period = periodic_p ? delay : std::chrono::milliseconds{0};
+    data->_due    = std::chrono::steady_clock::now() + delay;
+  }
+  data->_state      = uint64_t(data->generation() + 1) << 1 | ACTIVE;
+  return data;
+}
+
+void
+TaskHandle::Data::recycle()
+{
+  _f.reset();
+  _state = uint64_t(this->generation()) << 1;
+  {
+    std::lock_guard lock(Task_Pool_Lock);
+    if (Task_Pool_Count < MAX_POOLED) {
+      _next     = Task_Pool;
+      Task_Pool = this;
+      ++Task_Pool_Count;
+      return;
+    }
+  }
+  TSContDestroy(_cont);
+  delete this;
+}
+
+void
+TaskHandle::Data::run_instrumented()
+{
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  auto start = std::chrono::steady_clock::now();
+  _f();
+  auto end = std::chrono::steady_clock::now();
+  _stats->record(duration_cast<microseconds>(std::max(start - _due, decltype(start - _due)::zero())),
+                 duration_cast<microseconds>(end - start), _period);
+  // TS schedules the next run of a periodic event a period after the current run finishes.
+  _due = end + _period;
+}
+
+int
+TaskHandle::Data::dispatch(TSCont contp, TSEvent, void *event)
+{
+  // This runs under lock for the continuation mutex, therefore it can clean up as needed.
+  // External cancel tries the lock - if that succeeds it can cancel and prevent this entirely.
+  // If not, the task is marked inactive. For a periodic task that is detected here after the
+  // functor returns, or the next time the task runs.
+  auto data = static_cast<Data *>(TSContDataGet(contp));
+  if (data->_state & ACTIVE) {
+    data->_dispatching_p = true; // If the functor cancels its own task, clean up is left to this.
+    if (data->_stats) {
+      data->run_instrumented();
+    } else {
+      data->_f();
+    }
+    data->_dispatching_p = false;
+  }
+
+  if (!data->_periodic_p) {
+    data->recycle();
+  } else if (!(data->_state & ACTIVE)) {
+    TSActionCancel(static_cast<TSAction>(event));
+    data->recycle();
+  }
+  return 0;
+}
+
+void
+TaskHandle::cancel()
+{
+  if (_data == nullptr) {
+    return;
+  }
+  auto data = std::exchange(_data, nullptr); // Don't cancel again.
+  // Work around for TS shutdown - if this is cleaned up during shutdown, it's done on TS_MAIN
+  // which should have cleared its @c EThread data. If that's the case, though, there's
+  // no point in worrying about locks because the ET_NET threads aren't running. The
+  // @c Continuation can't be cleaned up because it's now thread allocated and there's no longer
+  // a thread freelist to use. Trying to do that will crash.
+  if (TSThreadSelf() == nullptr) {
+    data->deactivate(_generation);
+    return;
+  }
+
+  TSMutex m = TSContMutexGet(data->_cont);
+  if (TSMutexLockTry(m)) {
+    // The lock is held, therefore the task is either not running, or this is its functor, which is
+    // canceling its own task. In the first case, if it is still the same generation and active, it
+    // is still scheduled and can be canceled and cleaned up now. In the second, the dispatch does
+    // the clean up after the functor returns.
+    bool canceled_p = data->deactivate(_generation) && !data->_dispatching_p;
+    if (canceled_p) {
+      TSActionCancel(_action);
+    }
+    TSMutexUnlock(m);
+    if (canceled_p) {
+      data->recycle();
+    }
+  } else {
+    // Signal the task (which has the lock) that it should clean up.
+    data->deactivate(_generation);
+  }
+  _action = nullptr;
+}
+
+TaskHandle
+PerformAsTask(TaskFunction &&task, TaskStats const *stats)
+{
+  auto data = TaskHandle::Data::acquire(std::move(task), false, stats);
+  auto gen  = data->generation(); // @a data may be recycled before scheduling returns.
+  auto cont = data->_cont;
+  return {TSContScheduleOnPool(cont, 0, TS_THREAD_POOL_TASK), cont, data, gen};
+}
+
+TaskHandle
+PerformAsTaskEvery(TaskFunction &&task, std::chrono::milliseconds period, TaskStats const *stats)
+{
+  auto data = TaskHandle::Data::acquire(std::move(task), true, stats, period);
+  auto gen  = data->generation();
+  auto cont = data->_cont;
+  return {TSContScheduleEveryOnPool(cont, period.count(), TS_THREAD_POOL_TASK), cont, data, gen};
+}
+
+TaskHandle
+PerformAsTaskAfter(TaskFunction &&task, std::chrono::milliseconds delay, TSThreadPool pool)
+{
+  auto data = TaskHandle::Data::acquire(std::move(task), false);
+  auto gen  = data->generation();
+  auto cont = data->_cont;
+  return {TSContScheduleOnPool(cont, delay.count(), pool), cont, data, gen};
+}
+
+TaskHandle
+PerformAsTaskOn(TaskFunction &&task, TSEventThread thread, std::chrono::milliseconds delay)
+{
+  auto data = TaskHandle::Data::acquire(std::move(task), false);
+  auto gen  = data->generation();
+  auto cont = data->_cont;
+  return {TSContScheduleOnThread(cont, delay.count(), thread), cont, data, gen};
+}
+
+unsigned
+PerformAsTaskBatch(std::vector<TaskFunction> &&tasks, unsigned n_dispatch, TaskFunction &&done)
+{
+  struct Shared {
+    std::vector<TaskFunction> _tasks;  ///< Functors to run.
+    TaskFunction _done;                ///< Functor for after all of @a _tasks.
+    std::atomic<unsigned> _pending{0}; ///< Dispatches which have not finished.
+  };
+
+  if (tasks.empty()) { // Nothing to batch, but @a done is still run, and counted.
+    if (done) {
+      PerformAsTask(std::move(done));
+      return 1;
     }
     return 0;
+  }
+  n_dispatch        = std::max(n_dispatch, 1U);
+  size_t n          = tasks.size();
+  size_t chunk      = (n + n_dispatch - 1) / n_dispatch;
+  unsigned n_chunks = (n + chunk - 1) / chunk;
+  auto shared       = std::make_shared<Shared>();
+  shared->_tasks    = std::move(tasks);
+  shared->_done     = std::move(done);
+  shared->_pending  = n_chunks;
+  for (size_t begin = 0; begin < n; begin += chunk) {
+    PerformAsTask([shared, begin, end = std::min(n, begin + chunk)]() {
+      for (auto idx = begin; idx < end; ++idx) {
+        shared->_tasks[idx]();
+        shared->_tasks[idx].reset(); // Release resources as soon as possible.
+      }
+      if (1 == shared->_pending.fetch_sub(1) && shared->_done) {
+        shared->_done();
+      }
+    });
+  }
+  return n_chunks;
+}
+
+AdaptiveTask::AdaptiveTask(Function &&f, Policy const &policy) : _f(std::move(f)), _policy(policy)
+{
+  if (_policy._min_period.count() <= 0 || _policy._min_period > _policy._period) {
+    _policy._min_period = _policy._period;
+  }
+  if (_policy._max_period < _policy._period) {
+    _policy._max_period = _policy._period;
+  }
+  _policy._jitter = std::clamp(_policy._jitter, 0.0, 1.0);
+  _current        = _policy._period;
+}
+
+auto
+AdaptiveTask::start(Function &&f, Policy const &policy) -> std::shared_ptr<self_type>
+{
+  std::shared_ptr<self_type> self{new self_type(std::move(f), policy)};
+  std::lock_guard lock(self->_lock);
+  self->schedule(self->_current);
+  return self;
+}
+
+void
+AdaptiveTask::schedule(std::chrono::milliseconds delay)
+{
+  if (_policy._jitter > 0) {
+    thread_local std::minstd_rand rng{std::random_device{}()};
+    std::uniform_real_distribution<double> dist{-_policy._jitter, _policy._jitter};
+    delay = std::chrono::milliseconds{std::llround(delay.count() * (1 + dist(rng)))};
+  }
+  // Keep the jittered delay within the policy, and never zero, which would spin.
+  delay = std::max(std::clamp(delay, _policy._min_period, _policy._max_period), std::chrono::milliseconds{1});
+  // The sequence number makes any earlier run that could not be canceled a no-op.
+  _handle = PerformAsTaskAfter([self = this->shared_from_this(), seq = ++_seq]() { self->run(seq); }, delay);
+}
+
+void
+AdaptiveTask::run(uint64_t seq)
+{
+  {
+    std::lock_guard lock(_lock);
+    if (seq != _seq || _canceled_p) {
+      return;
+    }
+    _running_p = true;
+  }
+
+  auto outcome = _f();
+
+  std::lock_guard lock(_lock);
+  _running_p = false;
+  if (_canceled_p) {
+    return;
+  }
+  if (outcome == FAILED) {
+    ++_n_failures;
+    auto delay = _policy._period;
+    for (unsigned n = 0; n < _n_failures && delay < _policy._max_period; ++n) {
+      delay *= 2;
+    }
+    this->schedule(std::min(delay, _policy._max_period));
+    return;
+  }
+  _n_failures = 0;
+  if (outcome == MORE) {
+    _current = std::max(_current / 2, _policy._min_period);
+  } else if (outcome == IDLE) {
+    _current = std::min(_current * 2, _policy._max_period);
+  } else {
+    _current = _policy._period;
+  }
+  this->schedule(_current);
+}
+
+void
+AdaptiveTask::period_set(std::chrono::milliseconds period)
+{
+  std::lock_guard lock(_lock);
+  _policy._period     = period;
+  _policy._min_period = std::min(_policy._min_period, period);
+  _policy._max_period = std::max(_policy._max_period, period);
+  _current            = period;
+  // If running, the new period is used when the run finishes.
+  if (!_running_p && !_canceled_p) {
+    _handle.cancel();
+    this->schedule(_current);
+  }
+}
+
+std::chrono::milliseconds
+AdaptiveTask::period() const
+{
+  std::lock_guard lock(_lock);
+  return _policy._period;
+}
+
+void
+AdaptiveTask::cancel()
+{
+  std::lock_guard lock(_lock);
+  _canceled_p = true;
+  // If the functor is running, @a _handle is the task being dispatched - @c run sees the flag and
+  // does not reschedule.
+  if (!_running_p) {
+    _handle.cancel();
+  }
+}
+
+namespace
+{
+  /// Registered network threads.
+  struct NetThreadRegistry {
+    static constexpr size_t MAX_THREADS = 512; ///< Upper bound on network threads.
+
+    std::mutex _lock;                                               ///< Serialize registration.
+    std::array<std::atomic<TSEventThread>, MAX_THREADS> _threads{}; ///< Registered threads.
+    std::atomic<size_t> _count{0};                                  ///< Number of valid elements in @a _threads.
+  };
+
+  NetThreadRegistry Net_Threads;
+  thread_local bool Net_Thread_Registered_P = false;
+} // namespace
+
+void
+NetThreadRegister()
+{
+  if (Net_Thread_Registered_P) {
+    return;
+  }
+  Net_Thread_Registered_P = true;
+  if (auto thread = TSEventThreadSelf(); thread != nullptr) {
+    std::lock_guard lock(Net_Threads._lock);
+    auto n = Net_Threads._count.load();
+    if (n < Net_Threads._threads.size()) {
+      Net_Threads._threads[n] = thread;
+      Net_Threads._count      = n + 1; // Publish after the thread is set.
+    }
+  }
+}
+
+unsigned
+PerformOnEveryNetThread(std::function<void()> f, TaskFunction &&done)
+{
+  struct Shared {
+    /// Initial pending count, larger than any number of threads. It is reduced to the actual
+    /// number after scheduling, which can be after some of the threads have finished.
+    static constexpr unsigned UNKNOWN = 1U << 30;
+
+    std::function<void()> _f;          ///< Functor for every thread.
+    TaskFunction _done;                ///< Functor for after every thread.
+    std::atomic<unsigned> _pending{0}; ///< Threads which have not run @a _f.
+    TSCont _cont = nullptr;            ///< Broadcast continuation, if used.
+
+    /// Reduce the pending count by @a n, finishing if that is the last.
+    static void
+    release(Shared *self, unsigned n)
+    {
+      if (n == self->_pending.fetch_sub(n)) {
+        if (self->_done) {
+          self->_done();
+        }
+        if (self->_cont) {
+          TSContDestroy(self->_cont);
+        }
+        delete self;
+      }
+    }
   };
-  auto contp = TSContCreate(lambda, TSMutexCreate());
-  auto data  = new TaskHandle::Data(std::move(task));
-  TSContDataSet(contp, data);
-  return {TSContScheduleEveryOnPool(contp, period.count(), TS_THREAD_POOL_TASK), contp};
+
+  auto shared      = new Shared;
+  shared->_f       = std::move(f);
+  shared->_done    = std::move(done);
+  shared->_pending = Shared::UNKNOWN;
+
+  // Prefer scheduling on the entire pool, which reaches threads that were never registered.
+  shared->_cont = TSContCreate(
+    [](TSCont contp, TSEvent, void *) -> int {
+      auto self = static_cast<Shared *>(TSContDataGet(contp));
+      self->_f();
+      Shared::release(self, 1);
+      return 0;
+    },
+    nullptr);
+  TSContDataSet(shared->_cont, shared);
+  if (auto n = compat::schedule_on_entire_pool(shared->_cont, TS_THREAD_POOL_NET, swoc::meta::CaseArg); n) {
+    Shared::release(shared, Shared::UNKNOWN - *n);
+    return *n;
+  }
+  TSContDestroy(std::exchange(shared->_cont, nullptr));
+
+  // Fall back to the registered threads.
+  unsigned n = Net_Threads._count;
+  for (unsigned idx = 0; idx < n; ++idx) {
+    PerformAsTaskOn(
+      [shared]() {
+        shared->_f();
+        Shared::release(shared, 1);
+      },
+      Net_Threads._threads[idx]);
+  }
+  if (n == 0 && shared->_done) { // Run @a done on a task thread rather than the caller's.
+    PerformAsTask(std::move(shared->_done));
+  }
+  Shared::release(shared, Shared::UNKNOWN - n);
+  return n;
+}
+
+FutureStateBase::FutureStateBase() : _origin(TSEventThreadSelf()) {}
+
+void
+FutureStateBase::signal(std::shared_ptr<self_type> self, bool value_p)
+{
+  {
+    std::lock_guard lock(self->_lock);
+    (value_p ? self->_value_p : self->_then_p) = true;
+    if (!(self->_value_p && self->_then_p)) {
+      return;
+    }
+  }
+  auto thread = self->_origin;
+  TaskFunction f{[self = std::move(self)]() { self->deliver(); }};
+  if (thread != nullptr) {
+    PerformAsTaskOn(std::move(f), thread);
+  } else { // Not created on an event thread, use any network thread.
+    PerformAsTaskAfter(std::move(f), std::chrono::milliseconds{0}, TS_THREAD_POOL_NET);
+  }
 }
 /* ------------------------------------------------------------------------ */
 // --- OpenSSL support ---
@@ -1168,6 +2652,46 @@ bwformat(BufferWriter &w, bwf::Spec const &spec, TSRecordDataType type)
   return bwformat(w, spec, ts::TSRecordDataTypeNames[type]);
 }
 
+BufferWriter &
+bwformat(BufferWriter &w, bwf::Spec const &, ts::Status const &status)
+{
+  using ts::Status;
+  static constexpr std::array<TextView, 4> VALUE_TYPE = {"Null", "Integer", "Floating", "String"};
+  static constexpr TextView NO_NAME      = "";
+  static constexpr TextView QUOTED_VALUE = R"({} value "{}" )";
+  static constexpr TextView PLAIN_VALUE  = R"({} value {} )";
+
+  auto name         = status.var() ? status.var()->name() : NO_NAME;
+  auto const &value = status.value();
+  switch (status.code()) {
+  case Status::OK:
+    w.write("OK"_tv);
+    break;
+  case Status::INVALID_VALUE:
+  case Status::ASSIGN_FAILED:
+    w.print(value.index() == 3 ? QUOTED_VALUE : PLAIN_VALUE, VALUE_TYPE[value.index()], value);
+    if (status.code() == Status::INVALID_VALUE) {
+      w.print(R"(is not valid for transaction overridable configuration variable "{}".)", name);
+    } else {
+      w.print(R"(assignment to transaction overridable configuration variable "{}" failed.)", name);
+    }
+    break;
+  case Status::INVALID_TYPE:
+    w.print("Var '{}' does not have a valid data type [{}]", name, status.var() ? status.var()->type() : TS_RECORDDATATYPE_NULL);
+    break;
+  case Status::FETCH_FAILED:
+    w.print(R"(Failed to retrieve config variable "{}")", name);
+    break;
+  case Status::CACHE_KEY_FAILED:
+    w.write("Failed to set the cache key."_tv);
+    break;
+  case Status::ARG_FAILED:
+    w.write("Failed to reserve transaction argument index."_tv);
+    break;
+  }
+  return w;
+}
+
 BufferWriter &
 bwformat(BufferWriter &w, bwf::Spec const &spec, ts::ConfVarData const &data)
 {
@@ -1182,7 +2706,7 @@ bwformat(BufferWriter &w, bwf::Spec const &spec, ts::ConfVarData const &data)
     bwformat(w, spec, std::get<2>(data));
     break;
   case 3:
-    bwformat(w, spec, std::get<2>(data));
+    bwformat(w, spec, std::get<3>(data));
     break;
   }
   return w;
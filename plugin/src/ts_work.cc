@@ -0,0 +1,214 @@
+/** @file
+   Work stealing thread pool for CPU heavy background work.
+
+ * Copyright 2021 LinkedIn
+ * SPDX-License-Identifier: Apache-2.0
+*/
+
+#include <random>
+
+#include "ts_work.h"
+
+/* ------------------------------------------------------------------------------------ */
+namespace ts
+{
+/* ------------------------------------------------------------------------------------ */
+namespace
+{
+  /// The worker for the current thread, if it is in the pool.
+  thread_local void *Current_Worker = nullptr;
+} // namespace
+
+std::unique_ptr<WorkPool> WorkPool::_instance;
+std::once_flag WorkPool::_instance_once;
+
+// The deque operations follow "Correct and Efficient Work-Stealing for Weak Memory Models",
+// Lê et al., PPoPP 2013.
+
+bool
+WorkPool::Deque::push(Job *job)
+{
+  auto b = _bottom.load(std::memory_order_relaxed);
+  auto t = _top.load(std::memory_order_acquire);
+  if (b - t >= CAPACITY) {
+    return false;
+  }
+  _jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+auto
+WorkPool::Deque::pop() -> Job *
+{
+  auto b = _bottom.load(std::memory_order_relaxed) - 1;
+  _bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto t = _top.load(std::memory_order_relaxed);
+  if (t > b) { // empty
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  auto job = _jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (t == b) { // last job, race against thieves for it.
+    if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    _bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+auto
+WorkPool::Deque::steal() -> Job *
+{
+  auto t = _top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto b = _bottom.load(std::memory_order_acquire);
+  if (t >= b) {
+    return nullptr;
+  }
+  auto job = _jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return job;
+}
+
+WorkPool::WorkPool(unsigned n_threads)
+{
+  // Create all of the workers before starting any, as workers steal from each other.
+  for (unsigned idx = 0; idx < n_threads; ++idx) {
+    _workers.emplace_back(new Worker);
+  }
+  for (auto &w : _workers) {
+    w->_thread = std::thread([this, w = w.get()]() { this->run(w); });
+  }
+}
+
+WorkPool::~WorkPool()
+{
+  {
+    std::lock_guard lock(_idle_lock);
+    _stop_p = true;
+  }
+  _idle_cv.notify_all();
+  for (auto &w : _workers) {
+    w->_thread.join();
+  }
+}
+
+bool
+WorkPool::init(unsigned n_threads)
+{
+  // Replacing the pool could destroy it while other threads are using it, so it is set only once.
+  bool zret = false;
+  std::call_once(_instance_once, [&]() {
+    _instance.reset(new self_type(n_threads));
+    zret = true;
+  });
+  return zret;
+}
+
+auto
+WorkPool::instance() -> self_type &
+{
+  std::call_once(_instance_once, []() { _instance.reset(new self_type(0)); });
+  return *_instance;
+}
+
+void
+WorkPool::execute(Job *job)
+{
+  auto pending = job->_pending; // @a job may be gone after the decrement.
+  job->_run(job);
+  pending->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void
+WorkPool::spawn(Job *job)
+{
+  if (auto self = static_cast<Worker *>(Current_Worker); self != nullptr) {
+    if (!self->_deque.push(job)) {
+      execute(job); // Deque is full, the spawner does the work.
+      return;
+    }
+  } else {
+    std::lock_guard lock(_inject_lock);
+    _inject.push_back(job);
+  }
+  // Sequentially consistent, paired with @c run - either a worker going idle sees the new count,
+  // or this sees the idle worker and wakes it.
+  ++_n_spawned;
+  if (_n_idle > 0) {
+    std::lock_guard lock(_idle_lock); // Don't notify between the worker's check and its wait.
+    _idle_cv.notify_one();
+  }
+}
+
+auto
+WorkPool::find(Worker *self) -> Job *
+{
+  if (self) {
+    if (auto job = self->_deque.pop(); job) {
+      return job;
+    }
+  }
+  // Steal, starting at a random worker to spread contention.
+  thread_local std::minstd_rand rng{std::random_device{}()};
+  auto n     = _workers.size();
+  auto start = n ? rng() % n : 0;
+  for (size_t i = 0; i < n; ++i) {
+    auto victim = _workers[(start + i) % n].get();
+    if (victim == self) {
+      continue;
+    }
+    if (auto job = victim->_deque.steal(); job) {
+      return job;
+    }
+  }
+  std::lock_guard lock(_inject_lock);
+  if (!_inject.empty()) {
+    auto job = _inject.front();
+    _inject.pop_front();
+    return job;
+  }
+  return nullptr;
+}
+
+void
+WorkPool::wait(std::atomic<unsigned> &pending)
+{
+  auto self = static_cast<Worker *>(Current_Worker);
+  while (pending.load(std::memory_order_acquire) > 0) {
+    if (auto job = this->find(self); job) {
+      execute(job);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void
+WorkPool::run(Worker *self)
+{
+  Current_Worker = self;
+  while (!_stop_p) {
+    uint64_t spawned = _n_spawned; // Read before looking, so a later spawn is not missed.
+    if (auto job = this->find(self); job) {
+      execute(job);
+      continue;
+    }
+    // Nothing to do - sleep until there is a spawn.
+    std::unique_lock lock(_idle_lock);
+    ++_n_idle;
+    _idle_cv.wait(lock, [&]() { return _stop_p || _n_spawned != spawned; });
+    --_n_idle;
+  }
+  Current_Worker = nullptr;
+}
+
+/* ------------------------------------------------------------------------------------ */
+} // namespace ts
+/* ------------------------------------------------------------------------------------ */